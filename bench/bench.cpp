@@ -0,0 +1,250 @@
+/*
+Microbenchmarks of the search kernels.
+
+Every kernel runs on square maps of several sizes, with a snake that
+fills a given share of the map, and is repeated until it has run for a
+minimum time. The results are written as JSON with the time, the points
+expanded and the heap allocations per call.
+
+Usage: snake_bench [output file] [minimum time per case in ms]
+*/
+
+#include "base/snake.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include <omp.h>
+
+using std::string;
+using std::vector;
+
+static std::atomic<uint64_t> allocCnt(0);
+
+void* operator new(std::size_t size) {
+    ++allocCnt;
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+/*
+Access to the private search routines of Snake. Each wrapper treats the
+goal as empty during the search, as Snake::findPathTo() does.
+*/
+class SnakeBench {
+public:
+    static void findMinPath(Snake &snake, const Pos &goal, PathBuffer &path) {
+        search(snake, &Snake::findMinPath, goal, path);
+    }
+
+    static void findMinPathThreaded(Snake &snake, const Pos &goal, PathBuffer &path) {
+        search(snake, &Snake::findMinPathThreaded, goal, path);
+    }
+
+    static void findMinPathAStar(Snake &snake, const Pos &goal, PathBuffer &path) {
+        search(snake, &Snake::findMinPathAStar, goal, path);
+    }
+
+    static void findMinPathJPS(Snake &snake, const Pos &goal, PathBuffer &path) {
+        search(snake, &Snake::findMinPathJPS, goal, path);
+    }
+
+    static void findMaxPath(Snake &snake, const Pos &goal, PathBuffer &path) {
+        search(snake, &Snake::findMaxPath, goal, path);
+    }
+
+    static void findMaxPathExact(Snake &snake, const Pos &goal, PathBuffer &path) {
+        search(snake, &Snake::findMaxPathExact, goal, path);
+    }
+
+    static Pos getTail(const Snake &snake) {
+        return snake.getTail();
+    }
+
+    static void buildHamilton(Snake &snake) {
+        snake.buildHamilton();
+    }
+
+private:
+    typedef void (Snake::*Search)(const Pos &, const Pos &, PathBuffer &);
+
+    static void search(Snake &snake, const Search search, const Pos &goal, PathBuffer &path) {
+        Map *map = snake.map;
+        Point::Type oriType = map->getPoint(goal).getType();
+        map->setPointType(goal, Point::Type::EMPTY);
+        (snake.*search)(snake.getHead(), goal, path);
+        map->setPointType(goal, oriType);
+    }
+};
+
+struct Result {
+    string name;
+    Map::SizeType size;
+    double fill;
+    Map::SizeType length;
+    uint64_t iterations;
+    double nsPerOp;
+    double nodesPerOp;
+    double allocsPerOp;
+};
+
+/*
+A square map with a snake laid row by row from the top left corner, so
+that the rest of the map stays connected, and the food in the bottom
+right corner.
+*/
+struct Board {
+    Map map;
+    Snake snake;
+
+    Board(const Map::SizeType n, const double fill, const bool threaded) : map(n, n) {
+        Map::SizeType inner = n - 2;
+        Map::SizeType len = (Map::SizeType)(fill * inner * inner);
+        if (len < 3) {
+            len = 3;
+        }
+        vector<Pos> cells;
+        for (Map::SizeType i = 1; i <= inner && cells.size() < len; ++i) {
+            for (Map::SizeType k = 1; k <= inner && cells.size() < len; ++k) {
+                cells.push_back(Pos(i, i % 2 ? k : inner + 1 - k));
+            }
+        }
+        snake.setMap(&map);
+        snake.setSeed(1);
+        for (auto it = cells.rbegin(); it != cells.rend(); ++it) {
+            snake.addBody(*it);
+        }
+        snake.setDirection(cells[len - 2].getDirectionTo(cells[len - 1]));
+        if (threaded) {
+            snake.enableThreaded();
+        }
+        map.createFood(Pos(inner, inner));
+    }
+};
+
+/*
+Call a kernel until it has run for the minimum time and return its cost
+per call.
+*/
+static Result measure(const string &name, Board &board, const double fill,
+                      const double minTime, const std::function<void()> &kernel) {
+    typedef std::chrono::steady_clock Clock;
+    kernel();  // Warm up
+    uint64_t iters = 0, batch = 1;
+    uint64_t nodes = board.snake.getExpandedCount(), allocs = allocCnt;
+    double elapsed = 0;
+    Clock::time_point begin = Clock::now();
+    while (elapsed < minTime) {
+        for (uint64_t i = 0; i < batch; ++i) {
+            kernel();
+        }
+        iters += batch;
+        batch *= 2;
+        elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+    }
+    Result r;
+    r.name = name;
+    r.size = board.map.getRowCount();
+    r.fill = fill;
+    r.length = board.snake.getLength();
+    r.iterations = iters;
+    r.nsPerOp = elapsed * 1e9 / iters;
+    r.nodesPerOp = (double)(board.snake.getExpandedCount() - nodes) / iters;
+    r.allocsPerOp = (double)(allocCnt - allocs) / iters;
+    return r;
+}
+
+static void writeJSON(std::ostream &out, const vector<Result> &results) {
+    out << "{\n  \"threads\": " << omp_get_max_threads() << ",\n  \"benchmarks\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result &r = results[i];
+        double nodesPerSec = r.nsPerOp > 0 ? r.nodesPerOp * 1e9 / r.nsPerOp : 0;
+        out << "    {\"name\": \"" << r.name << "\", \"rows\": " << r.size << ", \"cols\": " << r.size
+            << ", \"fill\": " << r.fill << ", \"snake_length\": " << r.length
+            << ", \"iterations\": " << r.iterations << ", \"ns_per_op\": " << r.nsPerOp
+            << ", \"nodes_per_op\": " << r.nodesPerOp << ", \"nodes_per_sec\": " << nodesPerSec
+            << ", \"allocs_per_op\": " << r.allocsPerOp << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char **argv) {
+    const Map::SizeType SIZES[] = {10, 20, 50, 100};
+    const double FILLS[] = {0, 0.25, 0.5, 0.75};
+    double minTime = (argc > 2 ? std::atof(argv[2]) : 200) / 1000;
+
+    vector<Result> results;
+    PathBuffer path;
+    for (const Map::SizeType n : SIZES) {
+        for (const double fill : FILLS) {
+            Board seq(n, fill, false), thr(n, fill, true);
+            Pos food = seq.map.getFood();
+            results.push_back(measure("findMinPath", seq, fill, minTime, [&] {
+                SnakeBench::findMinPath(seq.snake, food, path);
+            }));
+            results.push_back(measure("findMinPathThreaded", thr, fill, minTime, [&] {
+                SnakeBench::findMinPathThreaded(thr.snake, food, path);
+            }));
+            results.push_back(measure("findMinPathAStar", seq, fill, minTime, [&] {
+                SnakeBench::findMinPathAStar(seq.snake, food, path);
+            }));
+            results.push_back(measure("findMinPathJPS", seq, fill, minTime, [&] {
+                SnakeBench::findMinPathJPS(seq.snake, food, path);
+            }));
+            Pos tail = SnakeBench::getTail(seq.snake);
+            results.push_back(measure("findMaxPath", seq, fill, minTime, [&] {
+                SnakeBench::findMaxPath(seq.snake, tail, path);
+            }));
+            results.push_back(measure("decideNext", seq, fill, minTime, [&] {
+                seq.snake.decideNext();
+            }));
+            util::Random<> random(1);
+            results.push_back(measure("createRandFood", seq, fill, minTime, [&] {
+                seq.map.removeFood();
+                seq.map.createRandFood(random);
+            }));
+            seq.map.removeFood();
+            seq.map.createFood(food);
+            if (n <= 20) {  // The exact search is meant for small maps
+                seq.snake.enableExactMaxPath();
+                results.push_back(measure("findMaxPathExact", seq, fill, minTime, [&] {
+                    SnakeBench::findMaxPathExact(seq.snake, tail, path);
+                }));
+            }
+            if (fill == 0) {  // The cycle does not depend on the snake
+                results.push_back(measure("buildHamilton", seq, fill, minTime, [&] {
+                    SnakeBench::buildHamilton(seq.snake);
+                }));
+            }
+            std::cerr << "map " << n << "*" << n << " fill " << fill << " done" << std::endl;
+        }
+    }
+
+    if (argc > 1) {
+        std::ofstream out(argv[1]);
+        if (!out) {
+            std::cerr << "Fail to open file: " << argv[1] << std::endl;
+            return -1;
+        }
+        writeJSON(out, results);
+    } else {
+        writeJSON(std::cout, results);
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+#ifndef SNAKE_BITBOARD_H
+#define SNAKE_BITBOARD_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/*
+A set of map points with one bit per point, packed into 64-bit words.
+Bit i stands for the point whose linear index (see Map::getIndex())
+is i, so a one-step move on the map is a shift of the whole bit array
+by 1 (LEFT/RIGHT) or by the column count (UP/DOWN).
+*/
+class Bitboard {
+public:
+    typedef std::size_t SizeType;
+    typedef uint64_t WordType;
+
+    static const SizeType WORD_BITS = 64;
+
+public:
+    Bitboard(const SizeType rowCnt_ = 0, const SizeType colCnt_ = 0);
+    ~Bitboard();
+
+    void set(const SizeType idx);
+    void reset(const SizeType idx);
+    bool test(const SizeType idx) const;
+
+    /*
+    Clear the words in [beg, end).
+    */
+    void clear(const SizeType beg, const SizeType end);
+
+    SizeType getWordCount() const;
+
+    /*
+    Return the number of words a one-step move can spread a set bit over
+    in each direction. Expanding the words [lo, hi) touches at most the
+    words [lo - reach, hi + reach).
+    */
+    SizeType getReach() const;
+
+    WordType* getWords();
+    const WordType* getWords() const;
+
+    /*
+    Compute the points adjacent to the points in this bitboard, keep the
+    ones also in a mask and write them to an output buffer. Only the words
+    in [beg, end) are computed; mask[0] and out[0] correspond to word beg.
+    out may alias mask.
+
+    The boundary walls of the map are never in the mask, so the bits that
+    a LEFT/RIGHT shift carries across the end of a row are always dropped.
+
+    @param beg  The first word to compute
+    @param end  The word after the last word to compute
+    @param mask The mask of the computed words
+    @param out  The result will be stored in this field
+    */
+    void expand(const SizeType beg, const SizeType end,
+                const WordType *mask, WordType *out) const;
+
+private:
+    SizeType colCnt;
+    SizeType wordCnt;
+    SizeType pad;                 // Zero words kept before and after the data
+    std::vector<WordType> words;  // pad words + wordCnt words + pad words
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef SNAKE_LONGESTPATH_H
+#define SNAKE_LONGESTPATH_H
+
+#include "base/map.h"
+#include "base/pathbuffer.h"
+#include <cstdint>
+
+/*
+Exact search for the longest simple path between two points through the
+empty points of a map. A depth-first search tries every path and prunes
+a branch when even the points it can still reach cannot make it longer
+than the best path found so far. The reachable points are counted by
+colour, as on a chessboard, since a path alternates between the colours.
+
+The search tree is split between threads by work stealing: a thread that
+runs out of branches takes the untried siblings nearest to the root from
+another thread. The search gives up when it expands more points or runs
+longer than its budget allows.
+*/
+class LongestPathSolver {
+public:
+    typedef Map::SizeType SizeType;
+
+public:
+    LongestPathSolver();
+    ~LongestPathSolver();
+
+    /*
+    Set the most points a search may expand, 0 for no limit.
+    */
+    void setNodeBudget(const uint64_t nodes);
+
+    /*
+    Set the longest time a search may run in microseconds, 0 for no limit.
+    */
+    void setTimeBudget(const uint64_t micros);
+
+    /*
+    Set the number of threads a search runs on, at least one.
+    */
+    void setThreadCount(const int threadCnt);
+
+    /*
+    Search for a path longer than a known one. The end point must be
+    empty, the start point is never revisited.
+
+    @param map        The map to search on, read only during the search
+    @param fromIdx    The index of the start point
+    @param toIdx      The index of the end point
+    @param lowerBound The number of steps of the known path
+    @param path       The longest path found if it is longer than the
+                      known one, left empty otherwise
+    @return true if the path is proved to be the longest, false if the
+            search ran out of its budget
+    */
+    bool solve(const Map &map, const SizeType fromIdx, const SizeType toIdx,
+               const SizeType lowerBound, PathBuffer &path);
+
+    /*
+    Return the number of points expanded by the last search.
+    */
+    uint64_t getNodeCount() const;
+
+private:
+    uint64_t nodeBudget = 0;
+    uint64_t timeBudget = 0;
+    int threadCnt = 1;
+    uint64_t nodeCnt = 0;
+};
+
+#endif
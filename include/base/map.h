@@ -2,7 +2,10 @@
 #define SNAKE_MAP_H
 
 #include "base/point.h"
-#include <list>
+#include "base/bitboard.h"
+#include "util/util.h"
+#include "base/pathbuffer.h"
+#include <utility>
 
 /*
 Game map.
@@ -18,6 +21,53 @@ public:
     Point& getPoint(const Pos &p);
     const Point& getPoint(const Pos &p) const;
 
+    /*
+    Return the point at a given linear index. Points are stored
+    row by row, so the index of (x, y) is x * colCnt + y.
+    */
+    Point& getPointAt(const SizeType idx);
+    const Point& getPointAt(const SizeType idx) const;
+
+    /*
+    Convert between a position and its linear index.
+    */
+    SizeType getIndex(const Pos &p) const;
+    Pos getPos(const SizeType idx) const;
+
+    /*
+    Return the linear index of the adjacent point at a given direction.
+    The boundary walls act as sentinels: the adjacent index of any point
+    inside the map is always valid, so no bounds check is made here.
+
+    @param idx The linear index of a point inside the map
+    @param d   The given direction
+    */
+    SizeType getAdjIndex(const SizeType idx, const Direction d) const;
+
+    /*
+    Set the type of a point. Point types must be changed through this
+    method so that the bitboard of empty points stays up to date.
+    */
+    void setPointType(const Pos &p, const Point::Type type);
+
+    /*
+    Return the bitboard of the empty points.
+    */
+    const Bitboard& getEmptyBits() const;
+
+    /*
+    Start recording the point type changes and the food position, so that
+    rollback() can undo them. Used to simulate moves on the map itself
+    instead of on a copy of it.
+    */
+    void beginTransaction();
+
+    /*
+    Undo all point type changes since beginTransaction() in reverse order,
+    restore the food position and stop recording.
+    */
+    void rollback();
+
     SizeType getRowCount() const;
     SizeType getColCount() const;
 
@@ -25,9 +75,39 @@ public:
     bool isEmpty(const Pos &p) const;
     bool isEmptyNotVisit(const Pos &p) const;
     bool isSafe(const Pos &p) const;
+
+    /*
+    Index-based versions of isEmpty() and isEmptyNotVisit(). The index
+    must be inside the map or on the boundary walls.
+    */
+    bool isEmptyAt(const SizeType idx) const;
+    bool isEmptyNotVisitAt(const SizeType idx) const;
+
+    /*
+    Start a new search. All points become unvisited, with distance
+    Point::MAX_VALUE, without touching them: a point only counts as
+    visited if it carries the stamp of the current search.
+    */
+    void beginSearch();
+
+    /*
+    Visit state and distance of a point in the current search.
+    setDistAt() also marks the point visited, and getDistAt() returns
+    Point::MAX_VALUE for unvisited points.
+    */
+    bool isVisitAt(const SizeType idx) const;
+    void setVisitAt(const SizeType idx);
+    Point::ValueType getDistAt(const SizeType idx) const;
+    void setDistAt(const SizeType idx, const Point::ValueType dist);
+
+    /*
+    Atomically mark a point visited in the current search. Return true
+    if this call marked it.
+    */
+    bool claimVisitAt(const SizeType idx);
     bool isAllBody() const;
 
-    void createRandFood();
+    void createRandFood(util::Random<> &random);
     void createFood(const Pos &pos);
     void removeFood();
     bool hasFood() const;
@@ -36,7 +116,7 @@ public:
     void setTestEnabled(const bool e);
     bool isTestEnabled() const;
     void showTestPos(const Pos &p);
-    void showTestPath(const Pos &start, const std::list<Direction> &path);
+    void showTestPath(const Pos &start, const PathBuffer &path);
 
     /*
     Return the number of points in the map excluding the boundaries.
@@ -57,11 +137,25 @@ private:
 
     void setPointTypeWithDelay(const Pos &p, const Point::Type type);
 
+    /*
+    Set the type of a point and update the bitboard without recording it.
+    */
+    void setTypeAt(const SizeType idx, const Point::Type type);
+
 private:
     bool testEnabled = false;
     Pos food;
     SizeType size;
-    std::vector<std::vector<Point>> content;
+    Point::ValueType searchStamp = 0;
+    SizeType rowCnt;
+    SizeType colCnt;
+    SizeType adjOffset[5];        // Index offset of each direction (unsigned wraparound for LEFT/UP)
+    std::vector<Point> content;   // Row-major points including the boundaries
+    Bitboard emptyBits;           // Bit set for each EMPTY point
+
+    bool inTransaction = false;
+    Pos transactionFood;
+    std::vector<std::pair<SizeType, Point::Type>> undoLog;  // Index and old type of each change
 };
 
 #endif
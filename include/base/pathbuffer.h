@@ -0,0 +1,154 @@
+#ifndef SNAKE_PATHBUFFER_H
+#define SNAKE_PATHBUFFER_H
+
+#include "base/direction.h"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+/*
+A path as a sequence of directions, packed 2 bits each into 64-bit words.
+The steps sit in the middle of the buffer with free room on both sides,
+so steps are added at either end in amortized constant time. The buffer
+keeps its storage when cleared and can be reused for the next search.
+NONE cannot be stored.
+*/
+class PathBuffer {
+public:
+    typedef std::size_t SizeType;
+    typedef uint64_t WordType;
+
+    static const SizeType WORD_STEPS = 32;
+
+    class const_iterator {
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef Direction value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const Direction* pointer;
+        typedef Direction reference;
+
+        const_iterator() {}
+        const_iterator(const PathBuffer *buf_, const SizeType slot_) : buf(buf_), slot(slot_) {}
+
+        Direction operator*() const {
+            return buf->get(slot);
+        }
+        const_iterator& operator++() {
+            ++slot;
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator tmp = *this;
+            ++slot;
+            return tmp;
+        }
+        const_iterator& operator--() {
+            --slot;
+            return *this;
+        }
+        const_iterator operator--(int) {
+            const_iterator tmp = *this;
+            --slot;
+            return tmp;
+        }
+        bool operator==(const const_iterator &it) const {
+            return slot == it.slot;
+        }
+        bool operator!=(const const_iterator &it) const {
+            return slot != it.slot;
+        }
+
+    private:
+        const PathBuffer *buf = nullptr;
+        SizeType slot = 0;
+    };
+
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+public:
+    PathBuffer();
+    ~PathBuffer();
+
+    SizeType size() const;
+    bool empty() const;
+
+    /*
+    Remove all the steps. The storage is kept.
+    */
+    void clear();
+
+    /*
+    Make room for at least a given number of steps.
+    */
+    void reserve(const SizeType n);
+
+    Direction front() const;
+    Direction back() const;
+    Direction operator[](const SizeType i) const;
+
+    void push_back(const Direction d);
+    void push_front(const Direction d);
+
+    /*
+    Add a straight run of cnt steps in direction d before the first step.
+    */
+    void push_front(const Direction d, const SizeType cnt);
+
+    void pop_back();
+    void pop_front();
+
+    /*
+    Replace the steps with the directions in [beg, end).
+    */
+    template<typename InputIt>
+    void assign(InputIt beg, InputIt end) {
+        clear();
+        for (; beg != end; ++beg) {
+            push_back(*beg);
+        }
+    }
+
+    /*
+    Add the steps [beg, end) of another path after the last step.
+    */
+    void append(const PathBuffer &other, const SizeType beg, const SizeType end);
+
+    /*
+    Move all the steps of another path into this one before step pos,
+    leaving the other path empty. The steps on the shorter side of pos
+    are moved aside to make room.
+    */
+    void splice(const SizeType pos, PathBuffer &other);
+
+    const_iterator begin() const;
+    const_iterator end() const;
+    const_reverse_iterator rbegin() const;
+    const_reverse_iterator rend() const;
+
+private:
+    Direction get(const SizeType slot) const {
+        return (Direction)(((words[slot / WORD_STEPS] >> (slot % WORD_STEPS * 2)) & 3) + 1);
+    }
+
+    void set(const SizeType slot, const Direction d) {
+        WordType &w = words[slot / WORD_STEPS];
+        SizeType shift = slot % WORD_STEPS * 2;
+        w = (w & ~((WordType)3 << shift)) | ((WordType)(d - 1) << shift);
+    }
+
+    SizeType capacity() const;
+
+    /*
+    Make sure there are free slots for at least front steps before the
+    first step and back steps after the last one.
+    */
+    void reserveSides(const SizeType front, const SizeType back);
+
+    std::vector<WordType> words;
+    SizeType first = 0;  // Slot of the first step
+    SizeType cnt = 0;
+};
+
+#endif
@@ -31,21 +31,28 @@ public:
 
     void setType(Type type_);
     void setParent(const Pos &p_);
-    void setVisit(const bool v);
     void setDist(const ValueType dist_);
     void setIdx(const ValueType index_);
+    void setStamp(const ValueType stamp_);
+
+    /*
+    Atomically set the stamp if it differs from the given one. Return true
+    if this call set the stamp, so that exactly one thread claims the point
+    when several threads race for it.
+    */
+    bool claimStamp(const ValueType stamp_);
     Type getType() const;
     Pos getParent() const;
-    bool isVisit() const;
     ValueType getDist() const;
     ValueType getIdx() const;
+    ValueType getStamp() const;
 
 private:
     Type type = EMPTY;
     Pos parent;
-    bool visit;
     ValueType dist;
     ValueType idx;
+    ValueType stamp = 0;  // Stamp of the last search that visited the point
 };
 
 #endif
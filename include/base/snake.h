@@ -2,6 +2,11 @@
 #define SNAKE_SNAKE_H
 
 #include "base/map.h"
+#include "base/longestpath.h"
+#include "util/ringbuffer.h"
+#include "util/histogram.h"
+#include "util/util.h"
+#include <chrono>
 
 /*
 Game snake.
@@ -10,14 +15,49 @@ class Snake {
 public:
     typedef Map::SizeType SizeType;
 
+    /*
+    Phases of decideNext() whose latencies are recorded.
+    */
+    enum Phase {
+        PHASE_DECIDE,              // The whole decideNext() call
+        PHASE_HAMILTON_SHORTCUT,   // Shortcut to the food off the Hamiltonian cycle
+        PHASE_FOOD_PATH,           // Step 1: shortest path to the food
+        PHASE_VIRTUAL_MOVE,        // Step 2: virtual snake eats the food and is rolled back
+        PHASE_TAIL_CHECK,          // Step 3: longest path from the virtual head to its tail
+        PHASE_FOLLOW_TAIL,         // Step 4: longest path to the tail
+        PHASE_WANDER,              // Step 5: move away from the food
+        PHASE_COUNT
+    };
+
+    /*
+    Return the lower case name of a phase.
+    */
+    static const char* getPhaseName(const Phase phase);
+
 public:
     Snake();
     ~Snake();
 
     bool isDead() const;
 
+    /*
+    Return the number of bodies, head and tail included.
+    */
+    SizeType getLength() const;
+
+    /*
+    Return the map indices of the bodies, from head to tail.
+    */
+    const util::RingBuffer<uint32_t>& getBodies() const;
+
     void setMap(Map *const m);
 
+    /*
+    Seed the snake's own random numbers, which break ties between the
+    equally short paths.
+    */
+    void setSeed(const uint64_t s);
+
     void setDirection(const Direction &d);
     Direction getDirection() const;
 
@@ -31,7 +71,7 @@ public:
     /*
     Move the snake along a given path.
     */
-    void move(const std::list<Direction> &path);
+    void move(const PathBuffer &path);
 
     /*
     Enable the snake AI based on the Hamiltonian cycle.
@@ -44,29 +84,62 @@ public:
 	void enableThreaded();
 
 	/*
-	Get the time that the longest BFS took
+	Find the shortest paths with the bit-parallel BFS on the bitboard
+	of empty points. Ignored when the snake is threaded.
+	*/
+	void enableBitboard();
+
+	/*
+	Find the shortest paths with the direction-optimizing BFS, which
+	switches between top-down and bottom-up levels. Ignored when the
+	snake is threaded or uses the bitboard.
+	*/
+	void enableHybrid();
+
+	/*
+	Find the shortest paths to the food with A*, guided by the Manhattan
+	distance. Ignored when the snake is threaded or uses the bitboard.
+	*/
+	void enableAStar();
+
+	/*
+	Find the shortest paths to the food with Jump Point Search, which
+	skips the straight runs of empty points. Ignored when the snake is
+	threaded, uses the bitboard or A*.
 	*/
-	double getMaxTimeBFS();
+	void enableJPS();
 
 	/*
-	Get the total amount of time to complete the BFS
+	Search for the longest paths to the tail exactly, starting from the
+	path found by the heuristic search. The search stops when it runs out
+	of its budget, keeping the longest path found. It is meant for small
+	maps, on which it often finishes.
+
+	@param nodeBudget The most points a search may expand, 0 for no limit
+	@param timeBudget The longest time a search may run in microseconds,
+	                  0 for no limit
 	*/
-	double getTotalTimeBFS();
-	
+	void enableExactMaxPath(const uint64_t nodeBudget = 100000, const uint64_t timeBudget = 10000);
+
 	/*
-	Get the total amount of time to complete the Graph Search
+	Get the latencies of a phase of decideNext() in nanoseconds
 	*/
-	double getTotalTimeGraphSearch();
+	const util::Histogram& getLatency(const Phase phase) const;
 
 	/*
-	Get the time that the longest Graph Search took
+	Get the number of points expanded by the shortest path searches so far
 	*/
-	double getMaxTimeGraphSearch();
+	uint64_t getExpandedCount() const;
 
 	/*
 	Is the algorithm threaded
 	*/
-	bool isThreaded();
+	bool isThreaded() const;
+
+	/*
+	Is the direction-optimizing BFS used
+	*/
+	bool isHybrid() const;
 
     /*
     Decide the next moving direction. After its execution,
@@ -74,21 +147,41 @@ public:
     */
     void decideNext();
 
-    void testMinPath(const Pos &from, const Pos &to, std::list<Direction> &path);
-    void testMaxPath(const Pos &from, const Pos &to, std::list<Direction> &path);
+    void testMinPath(const Pos &from, const Pos &to, PathBuffer &path);
+    void testMaxPath(const Pos &from, const Pos &to, PathBuffer &path);
     void testHamilton();
 	void testPathSearch();
-	int getMaxNumThreadsBFS();
-	int getMaxNumThreadsGraphSearch();
+	int getMaxNumThreadsBFS() const;
+	int getMaxNumThreadsGraphSearch() const;
 
 private:
+    typedef std::chrono::steady_clock Clock;
+
+    static const uint32_t NO_TAIL;
+
+    void decideNextDirection();
+
+    /*
+    Record the time elapsed since a given time point in the latencies
+    of a phase, and return the current time.
+    */
+    Clock::time_point recordLatency(const Phase phase, const Clock::time_point &since);
+
     void removeTail();
 
-    const Pos& getHead() const;
-    const Pos& getTail() const;
+    Pos getHead() const;
+    Pos getTail() const;
+
+    /*
+    Start a virtual simulation. The snake then moves on its map as usual,
+    but the moves are recorded and rollbackSimulation() undoes them on
+    both the snake and the map.
+    */
+    void beginSimulation();
+    void rollbackSimulation();
 
-    void findMinPathToFood(std::list<Direction> &path);
-    void findMaxPathToTail(std::list<Direction> &path);
+    void findMinPathToFood(PathBuffer &path);
+    void findMaxPathToTail(PathBuffer &path);
 
     /*
     Find path from the snake's head to a given position.
@@ -97,7 +190,7 @@ private:
     @param to   The given position
     @param path The result path will be stored in this field.
     */
-    void findPathTo(const int type, const Pos &to, std::list<Direction> &path);
+    void findPathTo(const int type, const Pos &to, PathBuffer &path);
 
     /*
     Find the shortest path AS STRAIGHT AS POSSIBLE between two positions.
@@ -106,7 +199,7 @@ private:
     @param to   The ending position
     @param path The result will be stored in this field
     */
-    void findMinPath(const Pos &from, const Pos &to, std::list<Direction> &path);
+    void findMinPath(const Pos &from, const Pos &to, PathBuffer &path);
 
 
 	/*
@@ -117,7 +210,79 @@ private:
 	@param to   The ending position
 	@param path The result will be stored in this field
 	*/
-	void findMinPathThreaded(const Pos &from, const Pos &to, std::list<Direction> &path);
+	void findMinPathThreaded(const Pos &from, const Pos &to, PathBuffer &path);
+
+	/*
+	Find the shortest path AS STRAIGHT AS POSSIBLE between two positions.
+	The BFS frontier of each level is a bitboard and grows 64 points per
+	word operation. The path is rebuilt from the frontiers of all levels.
+
+	@param from The starting position
+	@param to   The ending position
+	@param path The result will be stored in this field
+	*/
+	void findMinPathBitboard(const Pos &from, const Pos &to, PathBuffer &path);
+
+	/*
+	Find the shortest path AS STRAIGHT AS POSSIBLE between two positions.
+	Each level is expanded either top-down, from the frontier to its
+	unvisited neighbours, or bottom-up, from the unvisited points to a
+	parent on the frontier, whichever has fewer points to check.
+
+	@param from The starting position
+	@param to   The ending position
+	@param path The result will be stored in this field
+	*/
+	void findMinPathHybrid(const Pos &from, const Pos &to, PathBuffer &path);
+
+	/*
+	Find the shortest path AS STRAIGHT AS POSSIBLE between two positions.
+	A* with the Manhattan distance to the goal as the heuristic. The edges
+	have unit weights, so the open list is an array of buckets indexed by
+	the estimated path length, and the points of a bucket are expanded
+	last in first out, which favours the points closer to the goal.
+
+	@param from The starting position
+	@param to   The ending position
+	@param path The result will be stored in this field
+	*/
+	void findMinPathAStar(const Pos &from, const Pos &to, PathBuffer &path);
+
+	/*
+	Find the shortest path between two positions with Jump Point Search on
+	the 4-connected grid. Only the jump points, where a shortest path may
+	have to turn, enter the open list of an A* search, and the straight runs
+	between them are scanned without being queued.
+
+	@param from The starting position
+	@param to   The ending position
+	@param path The result will be stored in this field
+	*/
+	void findMinPathJPS(const Pos &from, const Pos &to, PathBuffer &path);
+
+	/*
+	Move from a point in a direction until a jump point, and return its
+	index, or 0 if a non-empty point is hit first. A point is a jump point
+	if it is the goal, or if a neighbour on the side becomes reachable that
+	was blocked one step back. Moving vertically, a point is also a jump
+	point if a horizontal jump from it finds one.
+
+	@param idx   The index of the first point of the move
+	@param d     The direction of the move
+	@param toIdx The index of the goal
+	*/
+	SizeType findJumpPoint(SizeType idx, const Direction d, const SizeType toIdx) const;
+
+	/*
+	Return the index of the parent of a point found by a BFS level, chosen
+	among its neighbours on the previous level. A neighbour the point can
+	be reached from without turning is preferred. Return 0 if there is none.
+
+	@param idx     The index of the point
+	@param fromIdx The index of the starting position of the BFS
+	@param level   The distance of the previous level
+	*/
+	SizeType findStraightParent(const SizeType idx, const SizeType fromIdx, const Point::ValueType level) const;
 
     /*
     Find the longest path between two positions.
@@ -126,17 +291,56 @@ private:
     @param to   The ending position
     @param path The result will be stored in this field
     */
-    void findMaxPath(const Pos &from, const Pos &to, std::list<Direction> &path);
+    void findMaxPath(const Pos &from, const Pos &to, PathBuffer &path);
 
 	/*
 	Find the longest path between two positions.
-	This implementation was threaded to increase performance
+	The path is cut into pieces that each stay in a stripe of a few rows,
+	the stripes are extended in parallel with the side points of their own
+	rows, and the pieces are stitched together and extended once more.
+
+	@param from The starting position
+	@param to   The ending position
+	@param path The result will be stored in this field
+	*/
+	void findMaxPathThreaded(const Pos &from, const Pos &to, PathBuffer &path);
+
+	/*
+	Find the longest path between two positions. The path found by the
+	heuristic search is replaced by a longer one if the exact search
+	finds one within its budget.
 
 	@param from The starting position
 	@param to   The ending position
 	@param path The result will be stored in this field
 	*/
-	void findMaxPathThreaded(const Pos &from, const Pos &to, std::list<Direction> &path);
+	void findMaxPathExact(const Pos &from, const Pos &to, PathBuffer &path);
+
+	/*
+	Extend a path with detours over the empty points that are not visited
+	yet, until no step of it can be extended. The points on the path must
+	be marked visited. The steps are checked from the start, and a step
+	that is extended is replaced by its detour, which is checked next.
+
+	@param fromIdx The index of the start of the path
+	@param path    The path to extend
+	*/
+	void extendPath(const SizeType fromIdx, PathBuffer &path);
+
+	/*
+	Extend a range of steps as extendPath() does, only with side points
+	whose indices lie in [lo, hi), and append the result to a path.
+
+	@param cur   The index of the start of the steps
+	@param steps The path holding the steps
+	@param beg   The first step
+	@param end   The end of the steps
+	@param lo    The lowest index of a side point
+	@param hi    The end of the indices of the side points
+	@param out   The path the extended steps are appended to
+	*/
+	void extendSteps(SizeType cur, const PathBuffer &steps, const SizeType beg, const SizeType end,
+					 const SizeType lo, const SizeType hi, PathBuffer &out);
 
     /*
     Build a path between two positions.
@@ -145,28 +349,54 @@ private:
     @param to   The end position
     @param path The result will be stored in this field.
     */
-    void buildPath(const Pos &from, const Pos &to, std::list<Direction> &path) const;
+    void buildPath(const Pos &from, const Pos &to, PathBuffer &path) const;
 
     /*
     Build a Hamiltonian cycle on the map.
-    The path index will be stored in the 'value' field of each Point.
+    The path index will be stored in the 'value' field of each Point,
+    and the direction to the next point of the cycle in cycleNext.
     */
     void buildHamilton();
 
+	/*
+	Find a neighbour of the head to take as a shortcut off the Hamiltonian
+	cycle in constant time. A shortcut must be a point of the cycle one
+	step closer to the food and, counted along the cycle from the tail,
+	lie after the head and not after the food, so the snake never
+	overtakes its own body. Of those neighbours, the one furthest along
+	the cycle is returned.
+
+	@return The direction of the shortcut, or NONE if there is none
+	*/
+	Direction findHamiltonShortcut() const;
+
 private:
     Map *map = nullptr;
-    std::list<Pos> bodies;
+    util::RingBuffer<uint32_t> bodies;  // Map indices of the bodies, from head to tail
+    util::Random<> random;
+
+    bool simulating = false;
+    std::vector<uint32_t> simMoves;     // Tail removed by each move since beginSimulation(), or NO_TAIL
+    Direction simDirec = NONE;
+    bool simDead = false;
     Direction direc = NONE;
     bool dead = false;
     bool hamiltonEnabled = false;
 	bool threaded = false;
+	bool bitboard = false;
+	bool hybrid = false;
+	bool astar = false;
+	bool jps = false;
+	bool exactMaxPath = false;
 	bool endTest = false;
-	double maxTimeBFS = 0;
-	double totalTimeBFS = 0;
-	double totalTimeGraphSearch = 0;
-	double maxTimeGraphSearch = 0;
+	LongestPathSolver maxPathSolver;
+	std::vector<Direction> cycleNext;  // Direction to the next point of the Hamiltonian cycle by map index
+	util::Histogram latencies[PHASE_COUNT];
 	int maxNumThreadsBFS = 0;
 	int maxNumThreadsGraphSearch = 0;
+	uint64_t expandedCnt = 0;
+
+	friend class SnakeBench;
 };
 
 #endif
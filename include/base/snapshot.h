@@ -0,0 +1,53 @@
+#ifndef SNAKE_SNAPSHOT_H
+#define SNAKE_SNAPSHOT_H
+
+#include "base/map.h"
+#include <cstdint>
+#include <vector>
+
+/*
+Compact copy of the visible state of a map: the type of each point, and
+the distance of the points marked by a test search. A snapshot can be
+read by another thread while the map keeps changing.
+*/
+class Snapshot {
+public:
+    typedef Map::SizeType SizeType;
+
+public:
+    Snapshot();
+    ~Snapshot();
+
+    /*
+    Copy the state of a map. The storage is reused when the map size
+    does not change.
+
+    @param map The map to copy
+    @param seq The sequence number of the snapshot
+    */
+    void capture(const Map &map, const uint64_t seq);
+
+    SizeType getRowCount() const;
+    SizeType getColCount() const;
+    uint64_t getSeq() const;
+
+    /*
+    Return the type of the point at a map index.
+    */
+    Point::Type getTypeAt(const SizeType idx) const;
+
+    /*
+    Return the distance of the point at a map index. Only valid for the
+    TEST_VISIT and TEST_PATH points.
+    */
+    Point::ValueType getDistAt(const SizeType idx) const;
+
+private:
+    SizeType rowCnt = 0;
+    SizeType colCnt = 0;
+    uint64_t seq = 0;
+    std::vector<uint8_t> types;
+    std::vector<Point::ValueType> dists;
+};
+
+#endif
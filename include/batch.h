@@ -0,0 +1,69 @@
+#ifndef SNAKE_BATCH_H
+#define SNAKE_BATCH_H
+
+#include "base/snake.h"
+#include <cstdint>
+#include <vector>
+
+/*
+Result of one headless game.
+*/
+struct GameResult {
+    uint64_t seed = 0;               // Seed of the game's random numbers
+    Map::SizeType moves = 0;         // Number of moves made
+    Map::SizeType length = 0;        // Snake length when the game ended
+    bool win = false;                // The snake filled the map
+    bool dead = false;               // The snake died
+    double timeDecide = 0;           // Total time in decideNext() in seconds
+    double timeBFS = 0;              // Total time of the shortest path searches
+    double timeGraphSearch = 0;      // Total time of the longest path searches
+};
+
+/*
+Headless engine that plays many independent games on a work-stealing
+thread pool. Every game has its own map and snake, and its random
+numbers are seeded from the base seed and the game number, so a batch
+gives the same results for any number of threads.
+*/
+class BatchRunner {
+public:
+    typedef Map::SizeType SizeType;
+
+public:
+    BatchRunner();
+    ~BatchRunner();
+
+    void setGameCount(const SizeType n);
+    void setThreadCount(const SizeType n);
+    void setSeed(const uint64_t s);
+    void setMapRow(const SizeType n);
+    void setMapCol(const SizeType n);
+    void setEnableHamilton(const bool enableHamilton_);
+    void setThreaded(const bool threaded_);
+
+    /*
+    Set the number of moves after which a game that neither won nor
+    lost is stopped. Zero means the square of the map size.
+    */
+    void setMaxMoves(const SizeType n);
+
+    /*
+    Play all the games and return their results in game order.
+    */
+    std::vector<GameResult> run() const;
+
+private:
+    GameResult runGame(const uint64_t gameSeed) const;
+
+private:
+    SizeType gameCnt = 100;
+    SizeType threadCnt = 0;  // Zero means one per hardware thread
+    uint64_t seed = 0;
+    SizeType mapRowCnt = 10;
+    SizeType mapColCnt = 10;
+    bool enableHamilton = true;
+    bool threaded = false;
+    SizeType maxMoves = 0;
+};
+
+#endif
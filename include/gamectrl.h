@@ -2,9 +2,19 @@
 #define SNAKE_GAMECTRL_H
 
 #include "base/snake.h"
+#include "base/snapshot.h"
+#include "recording.h"
 #include "util/console.h"
+#include "util/keyreader.h"
+#include "util/renderer.h"
+#include "util/spscqueue.h"
+#include "util/triplebuffer.h"
+#include <atomic>
+#include <condition_variable>
 #include <thread>
 #include <mutex>
+#include <ctime>
+#include <ostream>
 
 
 class GameCtrl {
@@ -24,16 +34,61 @@ public:
     void setEnableHamilton(const bool enableHamilton_);
     void setMoveInterval(const long ms);
     void setRecordMovements(const bool b);
+
+    /*
+    Set what the recording does when its writer thread falls behind.
+    Default is Recorder::Overflow::BLOCK.
+    */
+    void setRecordOverflow(const Recorder::Overflow overflow);
     void setRunTest(const bool b);
     void setMapRow(const SizeType n);
     void setMapCol(const SizeType n);
 
+    /*
+    Set the seed of the game's random numbers, so a game can be played
+    again exactly. Default is the current time.
+    */
+    void setSeed(const uint64_t s);
+
+    /*
+    Set the number of headless games to play in parallel instead of
+    the interactive game. Default is 0, which disables batch mode.
+    */
+    void setRunBatch(const SizeType games);
+
+    /*
+    Play a recording instead of a game, from a given tick to the end.
+    It plays at unlimited speed when the GUI is hidden or the movement
+    is unlocked, and at the move interval otherwise.
+    */
+    void setRunReplay(const std::string &filename, const uint64_t fromTick = 0);
+
+    /*
+    Set the file the decision latencies are written to when the game
+    exits, as CSV if the name ends with ".csv" and as JSON otherwise.
+    Default is empty: the latencies are printed as JSON after a test.
+    */
+    void setLatencyFile(const std::string &filename);
+
+    /*
+    Return the latencies of a phase of the snake's decisions in nanoseconds.
+    */
+    const util::Histogram& getLatency(const Snake::Phase phase) const;
+
     int run();
 
 private:
     GameCtrl();
 
-    void sleepFPS() const;
+    void sleepFPS();
+
+    /*
+    Sleep for a given time, or until exitGame() clears a switch.
+    */
+    void waitFor(const long ms, const std::atomic<bool> &running);
+
+    int runBatch();
+    int runReplay();
 
     void init();
     void initMap();
@@ -43,8 +98,17 @@ private:
     void mainLoop();
     void moveSnake();
 
+    /*
+    Publish a snapshot of the map to the draw thread. Only one thread may
+    publish: the game loop, or the draw thread itself in test mode, where
+    the searches change the map outside the game loop.
+    */
+    void publishFrame();
+
     void printMsg(const std::string &msg);
-    void saveMapContent() const;
+
+    void writeLatency(std::ostream &out, const bool csv) const;
+    void dumpLatency() const;
 
     void exitGame(const std::string &msg);
     void exitGameErr(const std::string &err);
@@ -55,14 +119,27 @@ private:
     void testHamilton();
 	void testSequentialPathSearch();
 	void testThreadedPathSearch();
+	void testHybridPathSearch();
+	void initPathSearchTest(const std::string &testName);
 
     void startSubThreads();
 
+    /*
+    Wait for the sub-threads to end, except the calling one. They must
+    have been told to stop.
+    */
+    void joinSubThreads();
+
     void draw();
-    void drawMapContent() const;
-    void drawTestPoint(const Point &p, const ConsoleColor &consoleColor) const;
+    void drawMapContent(const Snapshot &frame);
+    void drawTestPoint(const Pos &pos, const Point::ValueType dist, const ConsoleColor &consoleColor);
 
     void keyboard();
+
+    /*
+    Apply the keys queued by the keyboard thread. Called by the game loop.
+    */
+    void handleKeys();
     void keyboardMove(Snake &s, const Direction d);
 
 private:
@@ -72,8 +149,8 @@ private:
     static const std::string MSG_ESC;
     static const std::string MAP_INFO_FILENAME;
 
-	std::chrono::system_clock::time_point beginTime;
-	std::chrono::system_clock::time_point endTime;
+	std::chrono::steady_clock::time_point beginTime;
+	std::chrono::steady_clock::time_point endTime;
 
 	bool isThreaded = false;
 	bool visibleGUI = false;
@@ -86,22 +163,35 @@ private:
     bool runTest = false;
     SizeType mapRowCnt = 10;
     SizeType mapColCnt = 10;
+    SizeType batchGames = 0;
+    uint64_t seed = (uint64_t)std::time(nullptr);
+    std::string latencyFile;
+    std::string replayFile;
+    uint64_t replayStart = 0;
 
     Map *map = nullptr;
     Snake snake;
+    util::Random<> random;  // Places the food
 
-    volatile bool pause = false;  // Control pause/resume game
+    bool pause = false;  // Control pause/resume game, only used by the game loop
 
-    volatile bool runMainThread = true;  // Switch of the main thread
-    volatile bool runSubThread = true;   // Switch of sub-threads
+    std::atomic<bool> runMainThread;  // Switch of the main thread
+    std::atomic<bool> runSubThread;   // Switch of sub-threads
 
     std::thread drawThread;      // Thread to draw the map
-    std::thread keyboardThread;  // Thread to execute keyboard instructions
+    Renderer renderer;           // Frame buffer of the map, used by the draw thread
+    util::TripleBuffer<Snapshot> frames;  // Latest state of the map for the draw thread
+    uint64_t frameCnt = 0;                // Snapshots published
+    std::thread keyboardThread;  // Thread to read the keyboard
+    KeyReader keyReader;
+    util::SpscQueue<char> keys;  // Keys from the keyboard thread to the game loop
 
     std::mutex mutexMove;  // Mutex of moveSnake()
-    std::mutex mutexExit;  // Mutex of exitGame()
+    std::mutex mutexExit;  // Mutex of exitGame() and the waits on the switches
+    std::mutex mutexJoin;  // Mutex of joinSubThreads()
+    std::condition_variable exitCond;  // Notified when the switches are cleared
 
-    FILE *movementFile = nullptr;  // File to save snake movements
+    Recorder recorder;  // Records the snake movements
 };
 
 #endif
@@ -0,0 +1,301 @@
+#ifndef SNAKE_RECORDING_H
+#define SNAKE_RECORDING_H
+
+#include "base/snake.h"
+#include <cstdint>
+#include "util/spscqueue.h"
+#include "util/mappedfile.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <vector>
+
+/*
+Binary recording of a game.
+
+All integers are unsigned LEB128 varints except the seed, which is 8
+bytes little endian. The file starts with a header:
+
+    "SNKR" version rows cols seed keyframeInterval
+    wallCnt wall...   (map indices of the walls inside the boundary)
+    bodyCnt body...   (map indices of the initial snake, head first)
+
+followed by one record per tick. A tick is one call of the game's move,
+in which the snake moved one step, a new food appeared, or both:
+
+    byte      bits 0-2: direction moved, NONE if the snake did not move
+              bit 3:    FOOD_FLAG, the food index follows
+    [food]
+
+Every keyframeInterval ticks a keyframe follows the tick record. It
+holds the whole state after the tick, so a frame can be rebuilt without
+replaying the ticks before it:
+
+    KEYFRAME tick bodyCnt body... food+1   (food+1 is 0 without food)
+
+A keyframe whose tick is ahead of the last record stands for ticks the
+recorder dropped. Those frames are missing from the recording.
+
+A recording that was closed properly ends with a keyframe index, so a
+reader can jump to any tick without scanning the records. Integers here
+are 8 bytes little endian:
+
+    offset...                                (entryCnt of them)
+    recordsEnd tickCnt entryCnt "SNKI"
+
+Entry k is the file offset of the last keyframe at or before tick
+k * keyframeInterval, or 0 if there is none.
+*/
+namespace recording {
+
+extern const char MAGIC[4];
+extern const char INDEX_MAGIC[4];
+const uint8_t VERSION = 1;
+const uint8_t DIREC_MASK = 0x07;
+const uint8_t FOOD_FLAG = 0x08;
+const uint8_t KEYFRAME = 0x80;
+
+}
+
+/*
+Writes the recording of a game on its own thread. The game thread only
+encodes a few bytes per tick into a lock-free queue. The writer thread
+collects them into large blocks and writes a block once it is full or
+its oldest byte has waited for the flush interval.
+*/
+class Recorder {
+public:
+    typedef Map::SizeType SizeType;
+
+    /*
+    What record() does when the queue to the writer is full.
+    */
+    enum class Overflow {
+        BLOCK,  // Wait for the writer
+        DROP,   // Drop the tick, and write a keyframe once there is room again
+        GROW    // Keep the bytes in a backlog on the game thread, without limit
+    };
+
+public:
+    Recorder();
+
+    /*
+    Close the file.
+    */
+    ~Recorder();
+
+    /*
+    Set the number of ticks between two keyframes. Default is 1024.
+    */
+    void setKeyframeInterval(const SizeType n);
+
+    /*
+    Set the policy when the writer falls behind. Default is BLOCK.
+    */
+    void setOverflow(const Overflow overflow_);
+
+    /*
+    Set the capacity of the queue to the writer in bytes. Default is 1 MiB.
+    */
+    void setQueueCapacity(const SizeType bytes);
+
+    /*
+    Set the longest time a recorded byte waits before it is written to
+    the file. Default is 100 ms.
+    */
+    void setFlushInterval(const long ms);
+
+    /*
+    Return the number of ticks dropped with the DROP policy.
+    */
+    uint64_t getDroppedCount() const;
+
+    /*
+    Create a recording file, write the header with the initial state of
+    the game and start the writer thread.
+    */
+    void open(const std::string &filename, const Map &map, const Snake &snake, const uint64_t seed);
+
+    /*
+    Record a tick. Nothing is written if the snake did not move and the
+    food did not change.
+
+    @param moved The direction the snake moved in, NONE if it did not move
+    @param map   The map after the move
+    @param snake The snake after the move
+    */
+    void record(const Direction moved, const Map &map, const Snake &snake);
+
+    /*
+    Wait for the writer to write all the records and close the file.
+    */
+    void close();
+
+    bool isOpen() const;
+
+private:
+    void encodeVarint(uint64_t value);
+    void encodeFixed(const uint64_t value);
+    void encodeKeyframe(const Map &map, const Snake &snake);
+
+    /*
+    Hand the encoded bytes to the writer according to the overflow
+    policy. Return false if they were dropped.
+    */
+    bool push();
+
+    /*
+    Write the keyframe index at the end of the file.
+    */
+    void writeIndex();
+
+    /*
+    Move as much of the GROW backlog as fits into the queue.
+    */
+    void drainBacklog();
+
+    /*
+    Writer thread. Pop the queue into blocks and write them.
+    */
+    void write();
+
+private:
+    static const SizeType BLOCK_SIZE;
+
+    FILE *file = nullptr;
+    SizeType keyframeInterval = 1024;
+    Overflow overflow = Overflow::BLOCK;
+    SizeType queueCapacity = 1 << 20;
+    long flushInterval = 100;
+
+    // Game thread
+    std::vector<uint8_t> encoded;   // Bytes of the current tick
+    std::vector<uint8_t> backlog;   // Bytes waiting for room in the queue (GROW)
+    SizeType backlogBeg = 0;
+    uint64_t tick = 0;
+    SizeType lastFood = 0;          // Map index of the last recorded food, 0 for none
+    bool resync = false;            // A tick was dropped, the next record is a keyframe
+    uint64_t droppedCnt = 0;
+    uint64_t written = 0;           // File offset of the next byte pushed
+    std::vector<uint64_t> keyframeTicks;
+    std::vector<uint64_t> keyframeOffsets;
+
+    // Shared with the writer thread
+    util::SpscQueue<uint8_t> queue;
+    std::thread writer;
+    std::mutex mutex;               // Only guards the waits of the writer
+    std::condition_variable wakeup;
+    std::atomic<bool> stop;
+};
+
+/*
+Reads a recording file and rebuilds the state of the game at any tick.
+The file is memory-mapped. With the keyframe index, opening the file
+and finding the keyframe before a tick take constant time, and a seek
+replays at most keyframeInterval ticks from there.
+*/
+class Replay {
+public:
+    typedef Map::SizeType SizeType;
+
+public:
+    /*
+    Map a recording file. Throw std::runtime_error if it cannot be read
+    or is not a recording. A recording without the index, e.g. of a game
+    that crashed, is scanned once instead.
+    */
+    explicit Replay(const std::string &filename);
+    ~Replay();
+
+    SizeType getRowCount() const;
+    SizeType getColCount() const;
+    uint64_t getSeed() const;
+
+    /*
+    Return the number of ticks recorded.
+    */
+    uint64_t getTickCount() const;
+
+    /*
+    Return the tick of the current frame. Tick 0 is the initial state.
+    */
+    uint64_t getTick() const;
+
+    /*
+    Return the map of the current frame.
+    */
+    const Map& getMap() const;
+
+    /*
+    Rebuild the frame after a given number of ticks, starting from the
+    closest keyframe before it.
+    */
+    void seek(const uint64_t t);
+
+    /*
+    Advance one tick, or over a gap of dropped ticks. Return false if the
+    recording has ended.
+    */
+    bool step();
+
+private:
+    uint64_t readVarint(SizeType &offset) const;
+    uint64_t readFixed(const SizeType offset) const;
+
+    /*
+    Read the keyframe index. Return false if the file has none.
+    */
+    bool readIndex();
+
+    /*
+    Find the last keyframe at or before a tick by scanning the records.
+    Return its offset, or 0 if there is none.
+    */
+    SizeType scanKeyframe(const uint64_t t) const;
+
+    /*
+    Return the tick the next step() would reach, UINT64_MAX at the end.
+    */
+    uint64_t peekTick() const;
+
+    /*
+    Read the keyframe at a given offset and rebuild its frame.
+    */
+    void readKeyframe(SizeType &offset);
+
+    /*
+    Rebuild the map and the snake from a list of bodies and a food index.
+    */
+    void restore(const std::vector<SizeType> &bodyIdx, const SizeType foodIdx);
+
+    /*
+    Skip the keyframe of a given tick starting at a given offset, if any.
+    */
+    void skipKeyframe(SizeType &offset, const uint64_t t) const;
+
+private:
+    std::unique_ptr<util::MappedFile> file;
+    const uint8_t *data = nullptr;
+    SizeType recordsEnd = 0;  // Offset after the last tick record
+    SizeType indexBeg = 0;    // Offset of the keyframe index
+    SizeType indexCnt = 0;    // Entries in the keyframe index, 0 without index
+    SizeType rowCnt = 0;
+    SizeType colCnt = 0;
+    uint64_t seed = 0;
+    std::vector<SizeType> walls;
+    std::vector<SizeType> initBodies;
+    SizeType keyframeInterval = 1;
+    SizeType recordsBeg = 0;  // Offset of the first tick record
+    uint64_t tickCnt = 0;
+
+    std::unique_ptr<Map> map;
+    Snake snake;
+    uint64_t tick = 0;
+    SizeType offset = 0;  // Offset of the next tick record
+};
+
+#endif
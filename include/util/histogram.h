@@ -0,0 +1,60 @@
+#ifndef SNAKE_HISTOGRAM_H
+#define SNAKE_HISTOGRAM_H
+
+#include <cstdint>
+#include <vector>
+
+namespace util {
+
+/*
+Histogram of latencies with logarithmic buckets. Every power of two is
+split into SUB_BUCKET_CNT buckets, so a percentile is off by at most
+1/SUB_BUCKET_CNT of its value. Recording is a few integer operations
+and never allocates.
+*/
+class Histogram {
+public:
+    static const int SUB_BITS = 3;
+    static const int SUB_BUCKET_CNT = 1 << SUB_BITS;
+
+public:
+    Histogram();
+    ~Histogram();
+
+    void record(const uint64_t value);
+
+    /*
+    Add the samples of another histogram to this one.
+    */
+    void merge(const Histogram &other);
+
+    void clear();
+
+    uint64_t getCount() const;
+    uint64_t getTotal() const;
+    uint64_t getMin() const;
+    uint64_t getMax() const;
+    double getMean() const;
+
+    /*
+    Return the value below or at which a given share of the samples lie.
+
+    @param p The share in [0, 1], e.g. 0.99 for the 99th percentile
+    */
+    uint64_t getPercentile(const double p) const;
+
+private:
+    static int getBucket(const uint64_t value);
+    static uint64_t getBucketMax(const int bucket);
+
+private:
+    std::vector<uint64_t> buckets;
+    uint64_t count = 0;
+    uint64_t total = 0;
+    uint64_t min = UINT64_MAX;
+    uint64_t max = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef SNAKE_KEYREADER_H
+#define SNAKE_KEYREADER_H
+
+#include "util/console.h"
+#include <atomic>
+
+#ifdef OS_UNIX
+#include <termios.h>
+#endif
+
+/*
+Reads the keys typed on the console without busy waiting. On unix the
+reading thread blocks in poll() on stdin and on a pipe, so another thread
+can wake it up through the pipe, e.g. to stop it. While the reader is
+open the terminal is switched to unbuffered input without echo.
+*/
+class KeyReader {
+public:
+    KeyReader();
+
+    /*
+    Restore the terminal and close the pipe.
+    */
+    ~KeyReader();
+
+    /*
+    Switch the terminal to unbuffered input and discard earlier wakeups.
+    */
+    void open();
+
+    /*
+    Restore the terminal.
+    */
+    void close();
+
+    /*
+    Block until a key is typed and return true, or return false if the
+    reader was woken up or stdin has ended.
+    */
+    bool read(char &key);
+
+    /*
+    Make a blocked or the next read() return false. Can be called from
+    any thread.
+    */
+    void wakeup();
+
+private:
+#ifdef OS_UNIX
+    int pipeFds[2] = {-1, -1};  // Read and write end of the wakeup pipe
+    bool rawMode = false;       // Whether the terminal attributes were changed
+    struct termios oldAttr;     // Original terminal attributes
+#endif
+    std::atomic<bool> woken;
+};
+
+#endif
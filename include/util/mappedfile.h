@@ -0,0 +1,49 @@
+#ifndef SNAKE_MAPPEDFILE_H
+#define SNAKE_MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace util {
+
+/*
+Read-only memory mapping of a whole file. Pages are loaded by the OS on
+first access, so opening a large file costs nothing until it is read.
+*/
+class MappedFile {
+public:
+    typedef std::size_t SizeType;
+
+public:
+    /*
+    Map a file. Throw std::runtime_error if it cannot be mapped.
+    */
+    explicit MappedFile(const std::string &filename);
+
+    /*
+    Unmap the file.
+    */
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile& operator=(const MappedFile &) = delete;
+
+    const uint8_t* data() const;
+    SizeType size() const;
+
+private:
+    void release();
+
+private:
+    const uint8_t *ptr = nullptr;
+    SizeType len = 0;
+#if defined(WIN32) || defined(_WIN32)
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+};
+
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef SNAKE_RENDERER_H
+#define SNAKE_RENDERER_H
+
+#include "util/console.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+A frame buffer on the console made of cells two characters wide. Each
+frame is drawn into the buffer with setCell() and then sent by present(),
+which only outputs the cells that differ from the previous frame. Cells
+in a row that share a color are written under one color escape, and the
+whole frame goes to the terminal in a single write.
+*/
+class Renderer {
+public:
+    typedef std::size_t SizeType;
+
+public:
+    Renderer();
+    ~Renderer();
+
+    /*
+    Set the size of the frame in cells. Changing it redraws every cell
+    on the next present().
+    */
+    void resize(const SizeType rows, const SizeType cols);
+
+    /*
+    Set a cell of the next frame. The origin is at the left-top corner.
+
+    @param row   The row of the cell
+    @param col   The column of the cell
+    @param text  The text of the cell, only the first two characters are shown
+    @param color The color of the cell
+    */
+    void setCell(const SizeType row, const SizeType col, const std::string &text,
+                 const ConsoleColor &color);
+
+    /*
+    Redraw every cell on the next present(), e.g. after the console was cleared.
+    */
+    void invalidate();
+
+    /*
+    Output the cells changed since the last frame.
+    */
+    void present();
+
+private:
+    struct Cell {
+        char text[2];
+        uint8_t fore;
+        uint8_t back;
+        uint8_t foreIntensified;
+        uint8_t backIntensified;
+
+        bool sameColor(const Cell &c) const;
+        bool operator==(const Cell &c) const;
+        bool operator!=(const Cell &c) const;
+    };
+
+#ifdef OS_UNIX
+    void appendCursor(const SizeType row, const SizeType col);
+    void appendColor(const Cell &cell);
+    void appendInt(SizeType value);
+
+    /*
+    Write the output buffer to stdout, retrying partial writes.
+    */
+    void flush();
+#endif
+
+private:
+    SizeType rowCnt = 0;
+    SizeType colCnt = 0;
+    std::vector<Cell> cells;  // Next frame
+    std::vector<Cell> shown;  // Frame on the console
+    bool full = true;         // Whether the console content is unknown
+    std::string out;          // Bytes of a frame, reused between frames
+};
+
+#endif
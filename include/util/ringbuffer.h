@@ -0,0 +1,108 @@
+#ifndef SNAKE_RINGBUFFER_H
+#define SNAKE_RINGBUFFER_H
+
+#include <vector>
+#include <cstddef>
+
+namespace util {
+
+/*
+Fixed-capacity double-ended queue on a circular buffer. Pushing and
+popping at either end never allocates. The elements live in a single
+contiguous buffer, so copying a buffer of trivially copyable elements
+is a single memcpy.
+*/
+template<typename T>
+class RingBuffer {
+public:
+    typedef std::size_t SizeType;
+
+public:
+    RingBuffer() {}
+    ~RingBuffer() {}
+
+    /*
+    Change the capacity, keeping the current elements. The new capacity
+    must not be less than the current size.
+    */
+    void setCapacity(const SizeType capacity) {
+        std::vector<T> tmp(capacity);
+        for (SizeType i = 0; i < cnt; ++i) {
+            tmp[i] = (*this)[i];
+        }
+        buf.swap(tmp);
+        beg = 0;
+    }
+
+    SizeType capacity() const {
+        return buf.size();
+    }
+
+    SizeType size() const {
+        return cnt;
+    }
+
+    bool empty() const {
+        return cnt == 0;
+    }
+
+    void clear() {
+        beg = cnt = 0;
+    }
+
+    /*
+    Return the i-th element counted from the front.
+    */
+    T& operator[](const SizeType i) {
+        return buf[wrap(beg + i)];
+    }
+
+    const T& operator[](const SizeType i) const {
+        return buf[wrap(beg + i)];
+    }
+
+    const T& front() const {
+        return buf[beg];
+    }
+
+    const T& back() const {
+        return buf[wrap(beg + cnt - 1)];
+    }
+
+    void pushFront(const T &e) {
+        beg = (beg == 0 ? buf.size() : beg) - 1;
+        buf[beg] = e;
+        ++cnt;
+    }
+
+    void pushBack(const T &e) {
+        buf[wrap(beg + cnt)] = e;
+        ++cnt;
+    }
+
+    void popFront() {
+        beg = wrap(beg + 1);
+        --cnt;
+    }
+
+    void popBack() {
+        --cnt;
+    }
+
+private:
+    /*
+    Map a position in [0, 2 * capacity) into the buffer.
+    */
+    SizeType wrap(const SizeType i) const {
+        return i < buf.size() ? i : i - buf.size();
+    }
+
+private:
+    std::vector<T> buf;
+    SizeType beg = 0;  // Position of the front element
+    SizeType cnt = 0;  // Number of elements
+};
+
+}
+
+#endif
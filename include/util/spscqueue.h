@@ -0,0 +1,115 @@
+#ifndef SNAKE_SPSCQUEUE_H
+#define SNAKE_SPSCQUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace util {
+
+/*
+Bounded lock-free queue for exactly one producer thread and one consumer
+thread. Each side only writes its own index, and publishes it with a
+release store after the elements are copied, so no locks are needed.
+The capacity is rounded up to a power of two.
+*/
+template<typename T>
+class SpscQueue {
+public:
+    typedef std::size_t SizeType;
+
+public:
+    SpscQueue() : head(0), tail(0) {}
+    ~SpscQueue() {}
+
+    /*
+    Change the capacity and drop all the elements. Neither side may use
+    the queue meanwhile.
+    */
+    void setCapacity(const SizeType capacity) {
+        SizeType n = 1;
+        while (n < capacity) {
+            n <<= 1;
+        }
+        buf.assign(n, T());
+        mask = n - 1;
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+
+    SizeType capacity() const {
+        return buf.size();
+    }
+
+    /*
+    Return the number of elements. It is exact when called from either
+    side while the other side is idle, and a snapshot otherwise.
+    */
+    SizeType size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    /*
+    Producer: push as many elements as fit and return the count.
+    */
+    SizeType push(const T *items, const SizeType n) {
+        SizeType t = tail.load(std::memory_order_relaxed);
+        SizeType free = buf.size() - (t - head.load(std::memory_order_acquire));
+        SizeType cnt = std::min(n, free);
+        copyIn(t, items, cnt);
+        tail.store(t + cnt, std::memory_order_release);
+        return cnt;
+    }
+
+    /*
+    Producer: push all the elements, or none if they do not fit.
+    */
+    bool pushAll(const T *items, const SizeType n) {
+        SizeType t = tail.load(std::memory_order_relaxed);
+        if (buf.size() - (t - head.load(std::memory_order_acquire)) < n) {
+            return false;
+        }
+        copyIn(t, items, n);
+        tail.store(t + n, std::memory_order_release);
+        return true;
+    }
+
+    /*
+    Consumer: pop at most n elements into a buffer and return the count.
+    */
+    SizeType pop(T *out, const SizeType n) {
+        SizeType h = head.load(std::memory_order_relaxed);
+        SizeType cnt = std::min(n, tail.load(std::memory_order_acquire) - h);
+        for (SizeType i = 0; i < cnt; ++i) {
+            out[i] = buf[(h + i) & mask];
+        }
+        head.store(h + cnt, std::memory_order_release);
+        return cnt;
+    }
+
+private:
+    void copyIn(const SizeType t, const T *items, const SizeType n) {
+        for (SizeType i = 0; i < n; ++i) {
+            buf[(t + i) & mask] = items[i];
+        }
+    }
+
+private:
+    static const SizeType CACHE_LINE = 64;
+
+    std::vector<T> buf;
+    SizeType mask = 0;
+
+    // The indices only grow and are wrapped on access. They sit on
+    // separate cache lines so the two sides do not false-share.
+    char pad0[CACHE_LINE];
+    std::atomic<SizeType> head;  // Next element to pop, written by the consumer
+    char pad1[CACHE_LINE];
+    std::atomic<SizeType> tail;  // Next free slot, written by the producer
+    char pad2[CACHE_LINE];
+};
+
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef SNAKE_THREADPOOL_H
+#define SNAKE_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+/*
+A work-stealing thread pool. Each worker owns a task queue, takes its
+own tasks from the back and steals from the front of the other queues
+once its own queue is empty.
+*/
+class ThreadPool {
+public:
+    typedef std::size_t SizeType;
+    typedef std::function<void()> Task;
+
+public:
+    /*
+    Start the workers.
+
+    @param threadCnt The number of worker threads, at least one
+    */
+    explicit ThreadPool(const SizeType threadCnt);
+
+    /*
+    Wait for all the submitted tasks and stop the workers.
+    */
+    ~ThreadPool();
+
+    SizeType getThreadCount() const;
+
+    /*
+    Add a task. Tasks are spread over the worker queues round-robin.
+    */
+    void submit(const Task &task);
+
+    /*
+    Block until every submitted task has finished.
+    */
+    void wait();
+
+private:
+    struct Worker {
+        std::deque<Task> tasks;
+        std::mutex mutex;
+    };
+
+    void work(const SizeType id);
+
+    /*
+    Take a task from the back of the worker's own queue, or steal one
+    from the front of another queue. Return false if all queues are empty.
+    */
+    bool takeTask(const SizeType id, Task &task);
+
+private:
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;                  // Guards stop, nextWorker and the waits below
+    std::condition_variable taskCond;  // Signaled when a task is queued or the pool stops
+    std::condition_variable doneCond;  // Signaled when the last pending task finishes
+    bool stop = false;
+
+    std::atomic<SizeType> queued;      // Tasks waiting in the queues
+    std::atomic<SizeType> pending;     // Tasks submitted but not finished
+    SizeType nextWorker = 0;           // Queue of the next submitted task
+};
+
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef SNAKE_TRIPLEBUFFER_H
+#define SNAKE_TRIPLEBUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace util {
+
+/*
+Lock-free triple buffer to pass the latest value from one producer thread
+to one consumer thread. The producer fills the back slot and publishes it
+by swapping it with the middle slot. The consumer swaps the middle slot
+with its front slot when a new value was published. Neither side ever
+waits for the other, and the consumer always sees a whole value. Values
+the consumer did not take in time are overwritten.
+*/
+template<typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : middle(2) {}
+    ~TripleBuffer() {}
+
+    /*
+    Producer: return the slot to write the next value to. It keeps the
+    content of an older value, so a value can be updated in place.
+    */
+    T& back() {
+        return slots[backIdx];
+    }
+
+    /*
+    Producer: make the back slot the latest value.
+    */
+    void publish() {
+        backIdx = middle.exchange(backIdx | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    /*
+    Consumer: take the latest value if one was published since the last
+    call. Return false if front() is still the latest value.
+    */
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        frontIdx = middle.exchange(frontIdx, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    /*
+    Consumer: return the value taken by the last update().
+    */
+    const T& front() const {
+        return slots[frontIdx];
+    }
+
+private:
+    static const uint8_t INDEX_MASK = 0x03;
+    static const uint8_t FRESH = 0x04;  // The middle slot was not taken yet
+
+    T slots[3];
+    uint8_t backIdx = 0;          // Owned by the producer
+    uint8_t frontIdx = 1;         // Owned by the consumer
+    std::atomic<uint8_t> middle;  // Index of the middle slot and the FRESH bit
+};
+
+}
+
+#endif
@@ -7,6 +7,11 @@
 #include <ctime>
 #include <thread>
 #include <random>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 namespace util {
 
@@ -50,22 +55,120 @@ SizeType getDistance(const SizeType ori, const SizeType x, const SizeType size)
 }
 
 /*
-Random number generator.
+Atomically replace the value at a given address if it equals an expected
+value. Return true if the value was replaced.
+
+@param ptr      The address of the value
+@param expected The expected value
+@param desired  The new value
+*/
+inline bool compareAndSwap(volatile uint32_t *ptr, const uint32_t expected, const uint32_t desired) {
+#ifdef _MSC_VER
+    return _InterlockedCompareExchange((volatile long *)ptr, (long)desired, (long)expected) == (long)expected;
+#else
+    return __sync_bool_compare_and_swap(ptr, expected, desired);
+#endif
+}
+
+/*
+Return the number of set bits of a 64-bit word.
+*/
+inline int popCount(const uint64_t x) {
+#ifdef _MSC_VER
+    return (int)__popcnt64(x);
+#else
+    return __builtin_popcountll(x);
+#endif
+}
+
+/*
+Return the position of the highest set bit of a non-zero 64-bit word.
+*/
+inline int highestBit(const uint64_t x) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanReverse64(&i, x);
+    return (int)i;
+#else
+    return 63 - __builtin_clzll(x);
+#endif
+}
+
+/*
+xoshiro256** generator with splitmix64 seeding. It is much faster than
+std::default_random_engine and its streams are the same on every platform.
+Reference: http://prng.di.unimi.it/
 */
-template<typename RandEngine = std::default_random_engine>
+class Xoshiro256 {
+public:
+    typedef uint64_t result_type;
+
+    explicit Xoshiro256(const uint64_t s = 0) {
+        seed(s);
+    }
+
+    static constexpr result_type min() {
+        return 0;
+    }
+
+    static constexpr result_type max() {
+        return UINT64_MAX;
+    }
+
+    void seed(uint64_t s) {
+        for (int i = 0; i < 4; ++i) {
+            uint64_t z = (s += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            state[i] = z ^ (z >> 31);
+        }
+    }
+
+    result_type operator()() {
+        const uint64_t result = rotl(state[1] * 5, 7) * 9;
+        const uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
+
+private:
+    static uint64_t rotl(const uint64_t x, const int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    uint64_t state[4];
+};
+
+/*
+Random number generator. Each game owns its own instances and hands them
+to the code that needs random numbers, so games on different threads
+never share state and a seed replays a game exactly.
+*/
+template<typename RandEngine = Xoshiro256>
 class Random {
 public:
+    explicit Random(const uint64_t s = 0) : engine(s) {}
+
+    ~Random() {}
+
     /*
-    Destructor.
+    Restart the random sequence from a given seed.
     */
-    ~Random() {}
+    void seed(const uint64_t s) {
+        engine.seed(s);
+    }
 
     /*
-    Return the only instance.
+    Return the next raw number of the engine. Useful to seed other
+    generators from this one.
     */
-    static Random<>* getInstance() {
-        static Random<> instance;
-        return &instance;
+    uint64_t next() {
+        return (uint64_t)engine();
     }
 
     /*
@@ -99,13 +202,9 @@ public:
             }
         }
     }
+
 private:
     RandEngine engine;
-
-    /*
-    Initialize.
-    */
-    Random() : engine((unsigned)std::time(nullptr)) {}
 };
 
 }
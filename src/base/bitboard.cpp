@@ -0,0 +1,67 @@
+#include "base/bitboard.h"
+#include <algorithm>
+
+Bitboard::Bitboard(const SizeType rowCnt_, const SizeType colCnt_)
+    : colCnt(colCnt_),
+      wordCnt((rowCnt_ * colCnt_ + WORD_BITS - 1) / WORD_BITS),
+      pad(colCnt_ / WORD_BITS + 1),
+      words(wordCnt + 2 * pad, 0) {}
+
+Bitboard::~Bitboard() {}
+
+void Bitboard::set(const SizeType idx) {
+    words[pad + idx / WORD_BITS] |= (WordType)1 << (idx % WORD_BITS);
+}
+
+void Bitboard::reset(const SizeType idx) {
+    words[pad + idx / WORD_BITS] &= ~((WordType)1 << (idx % WORD_BITS));
+}
+
+bool Bitboard::test(const SizeType idx) const {
+    return (words[pad + idx / WORD_BITS] >> (idx % WORD_BITS)) & 1;
+}
+
+void Bitboard::clear(const SizeType beg, const SizeType end) {
+    std::fill(words.begin() + pad + beg, words.begin() + pad + end, 0);
+}
+
+Bitboard::SizeType Bitboard::getWordCount() const {
+    return wordCnt;
+}
+
+Bitboard::SizeType Bitboard::getReach() const {
+    return pad;
+}
+
+Bitboard::WordType* Bitboard::getWords() {
+    return words.data() + pad;
+}
+
+const Bitboard::WordType* Bitboard::getWords() const {
+    return words.data() + pad;
+}
+
+void Bitboard::expand(const SizeType beg, const SizeType end,
+                      const WordType *mask, WordType *out) const {
+    // The padding keeps every read below inside the buffer, so the loop
+    // bodies are branch-free and left for the compiler to vectorize.
+    const WordType *src = words.data() + pad;
+    const SizeType q = colCnt / WORD_BITS, r = colCnt % WORD_BITS;
+    if (r == 0) {
+        for (SizeType w = beg; w < end; ++w) {
+            WordType adj = (src[w] << 1) | (src[w - 1] >> (WORD_BITS - 1))   // RIGHT
+                         | (src[w] >> 1) | (src[w + 1] << (WORD_BITS - 1))   // LEFT
+                         | src[w - q]                                        // DOWN
+                         | src[w + q];                                       // UP
+            out[w - beg] = adj & mask[w - beg];
+        }
+    } else {
+        for (SizeType w = beg; w < end; ++w) {
+            WordType adj = (src[w] << 1) | (src[w - 1] >> (WORD_BITS - 1))
+                         | (src[w] >> 1) | (src[w + 1] << (WORD_BITS - 1))
+                         | (src[w - q] << r) | (src[w - q - 1] >> (WORD_BITS - r))
+                         | (src[w + q] >> r) | (src[w + q + 1] << (WORD_BITS - r));
+            out[w - beg] = adj & mask[w - beg];
+        }
+    }
+}
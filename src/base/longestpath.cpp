@@ -0,0 +1,353 @@
+#include "base/longestpath.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <omp.h>
+
+using std::vector;
+
+namespace {
+
+typedef LongestPathSolver::SizeType SizeType;
+typedef std::chrono::steady_clock Clock;
+
+const Direction DIRECTIONS[4] = {LEFT, UP, RIGHT, DOWN};
+const int NO_BRANCH = 4;                      // All the branches of a frame were tried
+const SizeType UNREACHABLE = (SizeType)-1;    // The end point cannot be reached
+const uint64_t CHECK_INTERVAL = 256;          // Points expanded between budget checks
+
+/*
+A subtree of the search, given by the path from the start point to its root
+*/
+typedef vector<SizeType> Task;
+
+struct Frame {
+    SizeType idx;
+    int nextDir;  // Index in DIRECTIONS of the next branch to try
+};
+
+struct Worker {
+    std::deque<Task> tasks;  // Own tasks are taken from the back, stolen from the front
+    std::mutex mutex;
+    vector<uint8_t> visited;
+    vector<uint32_t> marks;  // Points reached by the flood fill tagged with mark
+    uint32_t mark = 0;
+    vector<SizeType> queue;
+    vector<Frame> frames;
+    uint64_t nodes = 0;      // Points expanded since the last budget check
+};
+
+struct Search {
+    Search(const Map &map_, const SizeType toIdx_, const int threadCnt)
+        : map(map_), toIdx(toIdx_), workers(threadCnt), pending(0),
+          idle(0), stop(false), aborted(false), nodes(0), bestLen(0) {}
+
+    const Map &map;
+    SizeType toIdx;
+    vector<uint8_t> colors;  // Chessboard colour of each point
+    uint64_t nodeBudget = 0;
+    bool timed = false;
+    Clock::time_point deadline;
+    SizeType rootBound = 0;
+
+    vector<Worker> workers;
+    std::atomic<long> pending;    // Tasks queued or running
+    std::atomic<int> idle;        // Threads looking for a task
+    std::atomic<bool> stop;
+    std::atomic<bool> aborted;    // The budget ran out
+    std::atomic<uint64_t> nodes;
+    std::atomic<SizeType> bestLen;
+    std::mutex bestMutex;
+    vector<SizeType> best;
+};
+
+/*
+Return the most steps a path can still take from a point to the end point
+without touching the visited points, or UNREACHABLE. The steps alternate
+between the two colours, so they are limited by the reachable points of
+each colour, and their parity is given by the colours of both ends.
+*/
+SizeType bound(Search &s, Worker &w, const SizeType cur) {
+    if (cur == s.toIdx) {
+        return 0;
+    }
+    if (++w.mark == 0) {
+        std::fill(w.marks.begin(), w.marks.end(), 0);
+        w.mark = 1;
+    }
+    SizeType cnt[2] = {0, 0};
+    bool reached = false;
+    w.queue.clear();
+    w.queue.push_back(cur);
+    w.marks[cur] = w.mark;
+    for (SizeType i = 0; i < w.queue.size(); ++i) {
+        SizeType idx = w.queue[i];
+        for (const Direction d : DIRECTIONS) {
+            SizeType adj = s.map.getAdjIndex(idx, d);
+            if (w.marks[adj] == w.mark || w.visited[adj] || !s.map.isEmptyAt(adj)) {
+                continue;
+            }
+            w.marks[adj] = w.mark;
+            ++cnt[s.colors[adj]];
+            // A path ends at the end point, so the points behind it do not count
+            if (adj == s.toIdx) {
+                reached = true;
+            } else {
+                w.queue.push_back(adj);
+            }
+        }
+    }
+    if (!reached) {
+        return UNREACHABLE;
+    }
+    uint8_t color = s.colors[cur];
+    SizeType maxLen = std::min(2 * cnt[color ^ 1], 2 * cnt[color] + 1);
+    if ((maxLen & 1) != (SizeType)(s.colors[s.toIdx] != color)) {
+        --maxLen;
+    }
+    return maxLen;
+}
+
+bool checkBudget(Search &s, Worker &w) {
+    uint64_t total = s.nodes.fetch_add(w.nodes, std::memory_order_relaxed) + w.nodes;
+    w.nodes = 0;
+    if ((s.nodeBudget && total >= s.nodeBudget) || (s.timed && Clock::now() >= s.deadline)) {
+        s.aborted = true;
+        s.stop = true;
+        return false;
+    }
+    return true;
+}
+
+void record(Search &s, Worker &w) {
+    SizeType len = w.frames.size() - 1;
+    std::lock_guard<std::mutex> lock(s.bestMutex);
+    if (len <= s.bestLen.load(std::memory_order_relaxed)) {
+        return;
+    }
+    s.best.clear();
+    for (const Frame &f : w.frames) {
+        s.best.push_back(f.idx);
+    }
+    s.bestLen = len;
+    if (len >= s.rootBound) {
+        s.stop = true;  // Nothing can be longer
+    }
+}
+
+/*
+Hand the untried branches of the frame nearest to the root over to the
+other threads. Frames below base belong to the task being run.
+*/
+void donate(Search &s, Worker &w, const SizeType base) {
+    {
+        std::lock_guard<std::mutex> lock(w.mutex);
+        if (!w.tasks.empty()) {
+            return;
+        }
+    }
+    SizeType k = base - 1;
+    while (k < w.frames.size() && w.frames[k].nextDir == NO_BRANCH) {
+        ++k;
+    }
+    if (k >= w.frames.size() - 1) {
+        return;  // Only the point being expanded has branches left
+    }
+    Frame &f = w.frames[k];
+    for (; f.nextDir < NO_BRANCH; ++f.nextDir) {
+        SizeType adj = s.map.getAdjIndex(f.idx, DIRECTIONS[f.nextDir]);
+        if (!s.map.isEmptyAt(adj)) {
+            continue;
+        }
+        Task task;
+        bool onPath = false;
+        for (SizeType i = 0; i <= k; ++i) {
+            onPath = onPath || w.frames[i].idx == adj;
+            task.push_back(w.frames[i].idx);
+        }
+        if (onPath) {
+            continue;
+        }
+        task.push_back(adj);
+        ++s.pending;
+        std::lock_guard<std::mutex> lock(w.mutex);
+        w.tasks.push_back(std::move(task));
+    }
+}
+
+/*
+Search the subtree of a task depth-first.
+*/
+void run(Search &s, Worker &w, const Task &task) {
+    const SizeType base = task.size();
+    w.frames.clear();
+    for (SizeType i = 0; i < base; ++i) {
+        w.visited[task[i]] = 1;
+        w.frames.push_back({task[i], i + 1 < base ? NO_BRANCH : 0});
+    }
+    SizeType maxLen = bound(s, w, task.back());
+    if (maxLen == UNREACHABLE || base - 1 + maxLen <= s.bestLen) {
+        w.frames.clear();
+    }
+    while (w.frames.size() >= base && !s.stop.load(std::memory_order_relaxed)) {
+        Frame &top = w.frames.back();
+        if (top.idx == s.toIdx) {
+            record(s, w);
+            top.nextDir = NO_BRANCH;
+        }
+        if (top.nextDir == NO_BRANCH) {
+            w.visited[top.idx] = 0;
+            w.frames.pop_back();
+            continue;
+        }
+        SizeType adj = s.map.getAdjIndex(top.idx, DIRECTIONS[top.nextDir++]);
+        if (w.visited[adj] || !s.map.isEmptyAt(adj)) {
+            continue;
+        }
+        if (++w.nodes == CHECK_INTERVAL && !checkBudget(s, w)) {
+            break;
+        }
+        maxLen = bound(s, w, adj);
+        if (maxLen == UNREACHABLE || w.frames.size() + maxLen <= s.bestLen.load(std::memory_order_relaxed)) {
+            continue;
+        }
+        w.visited[adj] = 1;
+        w.frames.push_back({adj, 0});
+        if (s.idle.load(std::memory_order_relaxed) > 0) {
+            donate(s, w, base);
+        }
+    }
+    for (const Frame &f : w.frames) {
+        w.visited[f.idx] = 0;
+    }
+    for (const SizeType idx : task) {
+        w.visited[idx] = 0;
+    }
+}
+
+/*
+Take a task from the back of the worker's own queue, or steal one from
+the front of another queue, where the largest subtrees are.
+*/
+bool take(Search &s, const SizeType id, Task &task) {
+    SizeType cnt = s.workers.size();
+    for (SizeType i = 0; i < cnt; ++i) {
+        Worker &w = s.workers[(id + i) % cnt];
+        std::lock_guard<std::mutex> lock(w.mutex);
+        if (w.tasks.empty()) {
+            continue;
+        }
+        if (i == 0) {
+            task = std::move(w.tasks.back());
+            w.tasks.pop_back();
+        } else {
+            task = std::move(w.tasks.front());
+            w.tasks.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+
+void work(Search &s, const SizeType id) {
+    Worker &w = s.workers[id];
+    Task task;
+    bool idle = false;
+    while (!s.stop) {
+        if (take(s, id, task)) {
+            if (idle) {
+                --s.idle;
+                idle = false;
+            }
+            run(s, w, task);
+            --s.pending;
+        } else if (s.pending == 0) {
+            break;
+        } else {
+            if (!idle) {
+                ++s.idle;
+                idle = true;
+            }
+            std::this_thread::yield();
+        }
+    }
+    if (idle) {
+        --s.idle;
+    }
+    s.nodes += w.nodes;
+    w.nodes = 0;
+}
+
+}
+
+LongestPathSolver::LongestPathSolver() {}
+
+LongestPathSolver::~LongestPathSolver() {}
+
+void LongestPathSolver::setNodeBudget(const uint64_t nodes) {
+    nodeBudget = nodes;
+}
+
+void LongestPathSolver::setTimeBudget(const uint64_t micros) {
+    timeBudget = micros;
+}
+
+void LongestPathSolver::setThreadCount(const int threadCnt_) {
+    threadCnt = std::max(threadCnt_, 1);
+}
+
+uint64_t LongestPathSolver::getNodeCount() const {
+    return nodeCnt;
+}
+
+bool LongestPathSolver::solve(const Map &map, const SizeType fromIdx, const SizeType toIdx,
+                              const SizeType lowerBound, PathBuffer &path) {
+    path.clear();
+    nodeCnt = 0;
+    SizeType colCnt = map.getColCount();
+    SizeType indexCnt = map.getRowCount() * colCnt;
+    Search s(map, toIdx, threadCnt);
+    s.nodeBudget = nodeBudget;
+    s.timed = timeBudget > 0;
+    s.deadline = Clock::now() + std::chrono::microseconds(timeBudget);
+    s.colors.resize(indexCnt);
+    for (SizeType i = 0; i < indexCnt; ++i) {
+        s.colors[i] = (uint8_t)((i / colCnt + i % colCnt) & 1);
+    }
+    for (Worker &w : s.workers) {
+        w.visited.assign(indexCnt, 0);
+        w.marks.assign(indexCnt, 0);
+    }
+
+    Worker &first = s.workers[0];
+    first.visited[fromIdx] = 1;
+    s.rootBound = bound(s, first, fromIdx);
+    first.visited[fromIdx] = 0;
+    if (s.rootBound == UNREACHABLE || s.rootBound <= lowerBound) {
+        return true;
+    }
+    s.bestLen = lowerBound;
+    first.tasks.push_back(Task(1, fromIdx));
+    s.pending = 1;
+
+#pragma omp parallel num_threads(threadCnt)
+    work(s, (SizeType)omp_get_thread_num());
+
+    nodeCnt = s.nodes;
+    for (SizeType i = 1; i < s.best.size(); ++i) {
+        SizeType prev = s.best[i - 1], cur = s.best[i];
+        if (cur == prev + 1) {
+            path.push_back(RIGHT);
+        } else if (cur + 1 == prev) {
+            path.push_back(LEFT);
+        } else if (cur == prev + colCnt) {
+            path.push_back(DOWN);
+        } else {
+            path.push_back(UP);
+        }
+    }
+    return !s.aborted;
+}
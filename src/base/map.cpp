@@ -3,21 +3,29 @@
 
 using std::vector;
 using std::string;
-using std::list;
 
 Map::Map(const SizeType rowCnt_, const SizeType colCnt_)
-    : content(rowCnt_, vector<Point>(colCnt_)) {
+    : rowCnt(rowCnt_), colCnt(colCnt_), content(rowCnt_ * colCnt_),
+      emptyBits(rowCnt_, colCnt_) {
     size = (rowCnt_ - 2) * (colCnt_ - 2);
+    adjOffset[NONE] = 0;
+    adjOffset[LEFT] = (SizeType)-1;
+    adjOffset[UP] = (SizeType)0 - colCnt;
+    adjOffset[RIGHT] = 1;
+    adjOffset[DOWN] = colCnt;
     // Add boundary walls
     SizeType row = getRowCount(), col = getColCount();
     for (SizeType i = 0; i < row; ++i) {
         if (i == 0 || i == row - 1) {  // The first and last row
             for (SizeType j = 0; j < col; ++j) {
-                content[i][j].setType(Point::Type::WALL);
+                getPoint(Pos(i, j)).setType(Point::Type::WALL);
             }
         } else {  // Rows in the middle
-            content[i][0].setType(Point::Type::WALL);
-            content[i][col - 1].setType(Point::Type::WALL);
+            getPoint(Pos(i, 0)).setType(Point::Type::WALL);
+            getPoint(Pos(i, col - 1)).setType(Point::Type::WALL);
+            for (SizeType j = 1; j < col - 1; ++j) {
+                emptyBits.set(i * col + j);
+            }
         }
     }
 }
@@ -25,19 +33,75 @@ Map::Map(const SizeType rowCnt_, const SizeType colCnt_)
 Map::~Map() {}
 
 Point& Map::getPoint(const Pos &p) {
-    return content[p.getX()][p.getY()];
+    return content[getIndex(p)];
 }
 
 const Point& Map::getPoint(const Pos &p) const {
-    return content[p.getX()][p.getY()];
+    return content[getIndex(p)];
+}
+
+Point& Map::getPointAt(const SizeType idx) {
+    return content[idx];
+}
+
+const Point& Map::getPointAt(const SizeType idx) const {
+    return content[idx];
+}
+
+Map::SizeType Map::getIndex(const Pos &p) const {
+    return p.getX() * colCnt + p.getY();
+}
+
+Pos Map::getPos(const SizeType idx) const {
+    return Pos(idx / colCnt, idx % colCnt);
+}
+
+Map::SizeType Map::getAdjIndex(const SizeType idx, const Direction d) const {
+    return idx + adjOffset[d];
+}
+
+void Map::setPointType(const Pos &p, const Point::Type type) {
+    SizeType idx = getIndex(p);
+    if (inTransaction) {
+        undoLog.push_back(std::make_pair(idx, content[idx].getType()));
+    }
+    setTypeAt(idx, type);
+}
+
+void Map::setTypeAt(const SizeType idx, const Point::Type type) {
+    content[idx].setType(type);
+    if (type == Point::Type::EMPTY) {
+        emptyBits.set(idx);
+    } else {
+        emptyBits.reset(idx);
+    }
+}
+
+void Map::beginTransaction() {
+    undoLog.clear();
+    transactionFood = food;
+    inTransaction = true;
+}
+
+void Map::rollback() {
+    for (auto it = undoLog.rbegin(); it != undoLog.rend(); ++it) {
+        setTypeAt(it->first, it->second);
+    }
+    undoLog.clear();
+    food = transactionFood;
+    inTransaction = false;
+}
+
+const Bitboard& Map::getEmptyBits() const {
+    return emptyBits;
 }
 
 Map::SizeType Map::getRowCount() const {
-    return content.size();
+    return rowCnt;
 }
 
 Map::SizeType Map::getColCount() const {
-    return content[0].size();
+    return colCnt;
 }
 
 Map::SizeType Map::getSize() const {
@@ -63,7 +127,45 @@ bool Map::isEmpty(const Pos &p) const {
 }
 
 bool Map::isEmptyNotVisit(const Pos &p) const {
-    return isEmpty(p) && !getPoint(p).isVisit();
+    return isEmpty(p) && !isVisitAt(getIndex(p));
+}
+
+bool Map::isEmptyAt(const SizeType idx) const {
+    return content[idx].getType() == Point::Type::EMPTY;
+}
+
+bool Map::isEmptyNotVisitAt(const SizeType idx) const {
+    return isEmptyAt(idx) && !isVisitAt(idx);
+}
+
+void Map::beginSearch() {
+    if (++searchStamp == 0) {  // Wrapped around, stale stamps may match again
+        for (Point &point : content) {
+            point.setStamp(0);
+        }
+        searchStamp = 1;
+    }
+}
+
+bool Map::isVisitAt(const SizeType idx) const {
+    return content[idx].getStamp() == searchStamp;
+}
+
+void Map::setVisitAt(const SizeType idx) {
+    content[idx].setStamp(searchStamp);
+}
+
+Point::ValueType Map::getDistAt(const SizeType idx) const {
+    return isVisitAt(idx) ? content[idx].getDist() : Point::MAX_VALUE;
+}
+
+void Map::setDistAt(const SizeType idx, const Point::ValueType dist) {
+    content[idx].setStamp(searchStamp);
+    content[idx].setDist(dist);
+}
+
+bool Map::claimVisitAt(const SizeType idx) {
+    return content[idx].claimStamp(searchStamp);
 }
 
 bool Map::isSafe(const Pos &p) const {
@@ -76,7 +178,7 @@ bool Map::isAllBody() const {
     SizeType row = getRowCount(), col = getColCount();
     for (SizeType i = 1; i < row - 1; ++i) {
         for (SizeType j = 1; j < col - 1; ++j) {
-            Point::Type type = content[i][j].getType();
+            Point::Type type = content[i * col + j].getType();
             if (!(type == Point::Type::SNAKE_HEAD
                 || type == Point::Type::SNAKE_BODY
                 || type == Point::Type::SNAKE_TAIL)) {
@@ -87,23 +189,22 @@ bool Map::isAllBody() const {
     return true;
 }
 
-void Map::createRandFood() {
-    auto random = util::Random<>::getInstance();
+void Map::createRandFood(util::Random<> &random) {
     vector<Pos> emptyPoints = getEmptyPoints();
     if (!emptyPoints.empty()) {
-        SizeType i = random->nextInt((SizeType)0, emptyPoints.size() - 1);
+        SizeType i = random.nextInt((SizeType)0, emptyPoints.size() - 1);
         createFood(emptyPoints[i]);
     }
 }
 
 void Map::createFood(const Pos &pos) {
     food = pos;
-    content[food.getX()][food.getY()].setType(Point::Type::FOOD);
+    setPointType(food, Point::Type::FOOD);
 }
 
 void Map::removeFood() {
     if (hasFood()) {
-        content[food.getX()][food.getY()].setType(Point::Type::EMPTY);
+        setPointType(food, Point::Type::EMPTY);
     }
 }
 
@@ -124,7 +225,7 @@ Map::SizeType Map::distance(const Pos &from, const Pos &to) {
 }
 
 void Map::setPointTypeWithDelay(const Pos &p, const Point::Type type) {
-    getPoint(p).setType(type);
+    setPointType(p, type);
     util::sleep(20);
 }
 
@@ -134,7 +235,7 @@ void Map::showTestPos(const Pos &p) {
     }
 }
 
-void Map::showTestPath(const Pos &start, const list<Direction> &path) {
+void Map::showTestPath(const Pos &start, const PathBuffer &path) {
     if (testEnabled) {
         Pos tmp = start;
         for (const Direction &d : path) {
@@ -150,7 +251,7 @@ vector<Pos> Map::getEmptyPoints() const {
     SizeType row = getRowCount(), col = getColCount();
     for (SizeType i = 1; i < row - 1; ++i) {
         for (SizeType j = 1; j < col - 1; ++j) {
-            if (content[i][j].getType() == Point::Type::EMPTY) {
+            if (content[i * col + j].getType() == Point::Type::EMPTY) {
                 points.push_back(Pos(i, j));
             }
         }
@@ -0,0 +1,136 @@
+#include "base/pathbuffer.h"
+#include <algorithm>
+
+PathBuffer::PathBuffer() {}
+
+PathBuffer::~PathBuffer() {}
+
+PathBuffer::SizeType PathBuffer::size() const {
+    return cnt;
+}
+
+bool PathBuffer::empty() const {
+    return cnt == 0;
+}
+
+void PathBuffer::clear() {
+    // Leave the same room on both sides
+    first = capacity() / 2;
+    cnt = 0;
+}
+
+void PathBuffer::reserve(const SizeType n) {
+    if (n > cnt) {
+        reserveSides(0, n - cnt);
+    }
+}
+
+Direction PathBuffer::front() const {
+    return get(first);
+}
+
+Direction PathBuffer::back() const {
+    return get(first + cnt - 1);
+}
+
+Direction PathBuffer::operator[](const SizeType i) const {
+    return get(first + i);
+}
+
+void PathBuffer::push_back(const Direction d) {
+    if (first + cnt == capacity()) {
+        reserveSides(0, 1);
+    }
+    set(first + cnt++, d);
+}
+
+void PathBuffer::push_front(const Direction d) {
+    if (first == 0) {
+        reserveSides(1, 0);
+    }
+    set(--first, d);
+    ++cnt;
+}
+
+void PathBuffer::push_front(const Direction d, const SizeType n) {
+    reserveSides(n, 0);
+    for (SizeType i = 0; i < n; ++i) {
+        set(--first, d);
+    }
+    cnt += n;
+}
+
+void PathBuffer::pop_back() {
+    --cnt;
+}
+
+void PathBuffer::pop_front() {
+    ++first;
+    --cnt;
+}
+
+void PathBuffer::append(const PathBuffer &other, const SizeType beg, const SizeType end) {
+    reserveSides(0, end - beg);
+    for (SizeType i = beg; i < end; ++i) {
+        set(first + cnt++, other[i]);
+    }
+}
+
+void PathBuffer::splice(const SizeType pos, PathBuffer &other) {
+    SizeType n = other.cnt;
+    if (pos < cnt - pos) {
+        reserveSides(n, 0);
+        for (SizeType i = 0; i < pos; ++i) {
+            set(first - n + i, get(first + i));
+        }
+        first -= n;
+    } else {
+        reserveSides(0, n);
+        for (SizeType i = cnt; i-- > pos;) {
+            set(first + i + n, get(first + i));
+        }
+    }
+    for (SizeType i = 0; i < n; ++i) {
+        set(first + pos + i, other[i]);
+    }
+    cnt += n;
+    other.clear();
+}
+
+PathBuffer::const_iterator PathBuffer::begin() const {
+    return const_iterator(this, first);
+}
+
+PathBuffer::const_iterator PathBuffer::end() const {
+    return const_iterator(this, first + cnt);
+}
+
+PathBuffer::const_reverse_iterator PathBuffer::rbegin() const {
+    return const_reverse_iterator(end());
+}
+
+PathBuffer::const_reverse_iterator PathBuffer::rend() const {
+    return const_reverse_iterator(begin());
+}
+
+PathBuffer::SizeType PathBuffer::capacity() const {
+    return words.size() * WORD_STEPS;
+}
+
+void PathBuffer::reserveSides(const SizeType front, const SizeType back) {
+    if (first >= front && capacity() - first - cnt >= back) {
+        return;
+    }
+    // Grow at least twice, and put the steps in the middle of the free room
+    SizeType need = cnt + front + back;
+    SizeType wordCnt = std::max(words.size() * 2, (need + WORD_STEPS - 1) / WORD_STEPS + 1);
+    PathBuffer old;
+    old.words.swap(words);
+    old.first = first;
+    old.cnt = cnt;
+    words.assign(wordCnt, 0);
+    first = front + (capacity() - need) / 2;
+    for (SizeType i = 0; i < cnt; ++i) {
+        set(first + i, old[i]);
+    }
+}
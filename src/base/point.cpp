@@ -1,4 +1,5 @@
 #include "base/point.h"
+#include "util/util.h"
 
 const Point::ValueType Point::MAX_VALUE = UINT32_MAX;
 const Point::ValueType Point::EMPTY_DIST = 999999;
@@ -19,10 +20,6 @@ void Point::setParent(const Pos &p_) {
     parent = p_;
 }
 
-void Point::setVisit(const bool v) {
-    visit = v;
-}
-
 void Point::setDist(const ValueType dist_) {
     dist = dist_;
 }
@@ -31,12 +28,17 @@ void Point::setIdx(const ValueType index_) {
     idx = index_;
 }
 
-Pos Point::getParent() const {
-    return parent;
+void Point::setStamp(const ValueType stamp_) {
+    stamp = stamp_;
+}
+
+bool Point::claimStamp(const ValueType stamp_) {
+    ValueType old = stamp;
+    return old != stamp_ && util::compareAndSwap(&stamp, old, stamp_);
 }
 
-bool Point::isVisit() const {
-    return visit;
+Pos Point::getParent() const {
+    return parent;
 }
 
 Point::ValueType Point::getDist() const {
@@ -46,3 +48,7 @@ Point::ValueType Point::getDist() const {
 Point::ValueType Point::getIdx() const {
     return idx;
 }
+
+Point::ValueType Point::getStamp() const {
+    return stamp;
+}
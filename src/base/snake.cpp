@@ -7,9 +7,21 @@
 #include <omp.h>
 
 using std::vector;
-using std::list;
 using std::queue;
-using util::Random;
+
+const uint32_t Snake::NO_TAIL = UINT32_MAX;
+
+static uint64_t toNanos(const std::chrono::steady_clock::duration &d) {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+}
+
+const char* Snake::getPhaseName(const Phase phase) {
+	static const char *NAMES[PHASE_COUNT] = {
+		"decide", "hamilton_shortcut", "food_path", "virtual_move",
+		"tail_check", "follow_tail", "wander"
+	};
+	return NAMES[phase];
+}
 
 Snake::Snake() {}
 
@@ -21,6 +33,14 @@ void Snake::setDirection(const Direction &d) {
 
 void Snake::setMap(Map *const m) {
 	map = m;
+	// One extra slot for the new head pushed before the tail is removed
+	if (map && bodies.capacity() < map->getSize() + 1) {
+		bodies.setCapacity(map->getSize() + 1);
+	}
+}
+
+void Snake::setSeed(const uint64_t s) {
+	random.seed(s);
 }
 
 Direction Snake::getDirection() const {
@@ -31,14 +51,22 @@ bool Snake::isDead() const {
 	return dead;
 }
 
-void Snake::testMinPath(const Pos &from, const Pos &to, std::list<Direction> &path) {
+Snake::SizeType Snake::getLength() const {
+	return bodies.size();
+}
+
+const util::RingBuffer<uint32_t>& Snake::getBodies() const {
+	return bodies;
+}
+
+void Snake::testMinPath(const Pos &from, const Pos &to, PathBuffer &path) {
 	map->setTestEnabled(true);
 	findMinPath(from, to, path);
 	map->showTestPath(from, path);
 	map->setTestEnabled(false);
 }
 
-void Snake::testMaxPath(const Pos &from, const Pos &to, std::list<Direction> &path) {
+void Snake::testMaxPath(const Pos &from, const Pos &to, PathBuffer &path) {
 	map->setTestEnabled(true);
 	findMaxPath(from, to, path);
 	Pos cur = from;
@@ -73,70 +101,72 @@ void Snake::testPathSearch() {
 	}
 }
 
-bool Snake::isThreaded() {
+bool Snake::isThreaded() const {
 	return threaded;
 }
 
-double Snake::getMaxTimeBFS() {
-	return maxTimeBFS;
+bool Snake::isHybrid() const {
+	return hybrid;
 }
 
-double Snake::getTotalTimeBFS() {
-	return totalTimeBFS;
+const util::Histogram& Snake::getLatency(const Phase phase) const {
+	return latencies[phase];
 }
 
-double Snake::getTotalTimeGraphSearch() {
-	return totalTimeGraphSearch;
+uint64_t Snake::getExpandedCount() const {
+	return expandedCnt;
 }
 
-double Snake::getMaxTimeGraphSearch() {
-	return maxTimeGraphSearch;
-}
-
-int Snake::getMaxNumThreadsBFS() {
+int Snake::getMaxNumThreadsBFS() const {
 	return maxNumThreadsBFS;
 }
 
-int Snake::getMaxNumThreadsGraphSearch() {
+int Snake::getMaxNumThreadsGraphSearch() const {
 	return maxNumThreadsGraphSearch;
 }
 
 void Snake::addBody(const Pos &p) {
 	if (bodies.size() == 0) {  // Insert a head
-		map->getPoint(p).setType(Point::Type::SNAKE_HEAD);
+		map->setPointType(p, Point::Type::SNAKE_HEAD);
 	}
 	else {  // Insert a body
 		if (bodies.size() > 1) {
-			const Pos &oldTail = getTail();
-			map->getPoint(oldTail).setType(Point::Type::SNAKE_BODY);
+			Pos oldTail = getTail();
+			map->setPointType(oldTail, Point::Type::SNAKE_BODY);
 		}
-		map->getPoint(p).setType(Point::Type::SNAKE_TAIL);
+		map->setPointType(p, Point::Type::SNAKE_TAIL);
 	}
-	bodies.push_back(p);
+	bodies.pushBack((uint32_t)map->getIndex(p));
 }
 
 void Snake::move() {
 	if (isDead() || direc == NONE) {
 		return;
 	}
-	map->getPoint(getHead()).setType(Point::Type::SNAKE_BODY);
+	map->setPointType(getHead(), Point::Type::SNAKE_BODY);
 	Pos newHead = getHead().getAdj(direc);
-	bodies.push_front(newHead);
+	bodies.pushFront((uint32_t)map->getIndex(newHead));
+	if (simulating) {
+		simMoves.push_back(NO_TAIL);
+	}
 	if (!map->isSafe(newHead)) {
 		dead = true;
 	}
 	else {
 		if (map->getPoint(newHead).getType() != Point::Type::FOOD) {
+			if (simulating) {
+				simMoves.back() = bodies.back();
+			}
 			removeTail();
 		}
 		else {
 			map->removeFood();
 		}
 	}
-	map->getPoint(newHead).setType(Point::Type::SNAKE_HEAD);
+	map->setPointType(newHead, Point::Type::SNAKE_HEAD);
 }
 
-void Snake::move(const std::list<Direction> &path) {
+void Snake::move(const PathBuffer &path) {
 	for (const Direction &d : path) {
 		setDirection(d);
 		move();
@@ -155,7 +185,41 @@ void Snake::enableThreaded() {
 	threaded = true;
 }
 
+void Snake::enableBitboard() {
+	bitboard = true;
+}
+
+void Snake::enableHybrid() {
+	hybrid = true;
+}
+
+void Snake::enableAStar() {
+	astar = true;
+}
+
+void Snake::enableJPS() {
+	jps = true;
+}
+
+void Snake::enableExactMaxPath(const uint64_t nodeBudget, const uint64_t timeBudget) {
+	exactMaxPath = true;
+	maxPathSolver.setNodeBudget(nodeBudget);
+	maxPathSolver.setTimeBudget(timeBudget);
+}
+
 void Snake::decideNext() {
+	Clock::time_point begin = Clock::now();
+	decideNextDirection();
+	recordLatency(PHASE_DECIDE, begin);
+}
+
+Snake::Clock::time_point Snake::recordLatency(const Phase phase, const Clock::time_point &since) {
+	Clock::time_point now = Clock::now();
+	latencies[phase].record(toNanos(now - since));
+	return now;
+}
+
+void Snake::decideNextDirection() {
 	if (isDead()) {
 		return;
 	}
@@ -167,81 +231,69 @@ void Snake::decideNext() {
 	if (hamiltonEnabled) {  // AI based on the Hamiltonian cycle
 
 		SizeType size = map->getSize();
-		Pos head = getHead(), tail = getTail();
-		Point::ValueType tailIndex = map->getPoint(tail).getIdx();
-		Point::ValueType headIndex = map->getPoint(head).getIdx();
+		SizeType headIdx = bodies.front();
+		if (cycleNext[headIdx] == NONE || cycleNext[map->getIndex(map->getFood())] == NONE) {
+			// The cycle misses the head or the food, which happens when the
+			// map had other obstacles as it was built, so search for the food
+			PathBuffer minPath;
+			findMinPathToFood(minPath);
+			direc = minPath.empty() ? cycleNext[headIdx] : minPath.front();
+			return;
+		}
 		// Try to take shortcuts when the snake is not long enough
 		if (bodies.size() < size * 3 / 4) {
-			list<Direction> minPath;
-			findMinPathToFood(minPath);
-			if (!minPath.empty()) {
-				Direction nextDirec = *minPath.begin();
-				Pos nextPos = head.getAdj(nextDirec);
-				Point::ValueType nextIndex = map->getPoint(nextPos).getIdx();
-				Point::ValueType foodIndex = map->getPoint(map->getFood()).getIdx();
-				headIndex = util::getDistance(tailIndex, headIndex, (Point::ValueType)size);
-				nextIndex = util::getDistance(tailIndex, nextIndex, (Point::ValueType)size);
-				foodIndex = util::getDistance(tailIndex, foodIndex, (Point::ValueType)size);
-				if (nextIndex > headIndex && nextIndex <= foodIndex) {
-					direc = nextDirec;
-					return;
-				}
+			Clock::time_point begin = Clock::now();
+			Direction shortcut = findHamiltonShortcut();
+			recordLatency(PHASE_HAMILTON_SHORTCUT, begin);
+			if (shortcut != NONE) {
+				direc = shortcut;
+				return;
 			}
 		}
 		// Move along the hamitonian cycle
-		headIndex = map->getPoint(head).getIdx();
-		vector<Pos> adjPositions = head.getAllAdj();
-
-		for (const Pos &adjPos : adjPositions) {
-			const Point &adjPoint = map->getPoint(adjPos);
-			Point::ValueType adjIndex = adjPoint.getIdx();
-			if (adjIndex == (headIndex + 1) % size) {
-				direc = head.getDirectionTo(adjPos);
-			}
-		}
+		direc = cycleNext[headIdx];
 
 	}
 	else {  // AI based on graph search
-		list<Direction> pathToFood, pathToTail;
-		// Create a virtual snake
-		Map tmpMap = *map;
-		Snake tmpSnake(*this);
-		tmpSnake.setMap(&tmpMap);
+		PathBuffer pathToFood, pathToTail;
 		// Step 1
-		tmpSnake.findMinPathToFood(pathToFood);
-		totalTimeGraphSearch = tmpSnake.getTotalTimeGraphSearch();
-		maxTimeGraphSearch = tmpSnake.getMaxTimeGraphSearch();
-		maxNumThreadsGraphSearch = tmpSnake.getMaxNumThreadsGraphSearch();
+		Clock::time_point begin = Clock::now();
+		findMinPathToFood(pathToFood);
+		begin = recordLatency(PHASE_FOOD_PATH, begin);
+		SizeType virtualBodyCnt = bodies.size();
 		if (!pathToFood.empty()) {
-			// Step 2
-			tmpSnake.move(pathToFood);
-			totalTimeGraphSearch = tmpSnake.getTotalTimeGraphSearch();
-			maxTimeGraphSearch = tmpSnake.getMaxTimeGraphSearch();
-			maxNumThreadsGraphSearch = tmpSnake.getMaxNumThreadsGraphSearch();
-			if (tmpMap.isAllBody()) {
-				this->setDirection(*(pathToFood.begin()));
-				return;
-			}
-			else {
+			// Step 2: let a virtual snake eat the food. The moves are made on
+			// the real map and undone after Step 3, so nothing is copied.
+			beginSimulation();
+			move(pathToFood);
+			virtualBodyCnt = bodies.size();
+			bool safe = map->isAllBody();
+			Clock::time_point moved = Clock::now();
+			if (!safe) {
 				// Step 3
-				tmpSnake.findMaxPathToTail(pathToTail);
-				totalTimeGraphSearch = tmpSnake.getTotalTimeGraphSearch();
-				maxTimeGraphSearch = tmpSnake.getMaxTimeGraphSearch();
-				maxNumThreadsGraphSearch = tmpSnake.getMaxNumThreadsGraphSearch();
-				if (pathToTail.size() > 1) {
-					this->setDirection(*(pathToFood.begin()));
-					return;
-				}
+				findMaxPathToTail(pathToTail);
+				safe = pathToTail.size() > 1;
+				recordLatency(PHASE_TAIL_CHECK, moved);
+			}
+			Clock::time_point checked = Clock::now();
+			rollbackSimulation();
+			// The virtual move is timed without the tail check
+			latencies[PHASE_VIRTUAL_MOVE].record(toNanos((moved - begin) + (Clock::now() - checked)));
+			if (safe) {
+				this->setDirection(pathToFood.front());
+				return;
 			}
 		}
 
-		if (tmpSnake.bodies.size() == 4)
+		if (virtualBodyCnt == 4)
 			endTest = true;
 
 		// Step 4
+		begin = Clock::now();
 		this->findMaxPathToTail(pathToTail);
+		begin = recordLatency(PHASE_FOLLOW_TAIL, begin);
 		if (pathToTail.size() > 1) {
-			this->setDirection(*(pathToTail.begin()));
+			this->setDirection(pathToTail.front());
 			return;
 		}
 		// Step 5
@@ -258,186 +310,215 @@ void Snake::decideNext() {
 				}
 			}
 		}
+		recordLatency(PHASE_WANDER, begin);
 	}
 }
 
-const Pos& Snake::getHead() const {
-	return *bodies.begin();
+Pos Snake::getHead() const {
+	return map->getPos(bodies.front());
 }
 
-const Pos& Snake::getTail() const {
-	return *bodies.rbegin();
+Pos Snake::getTail() const {
+	return map->getPos(bodies.back());
 }
 
 void Snake::removeTail() {
-	map->getPoint(getTail()).setType(Point::Type::EMPTY);
-	bodies.pop_back();
+	map->setPointType(getTail(), Point::Type::EMPTY);
+	bodies.popBack();
 	if (bodies.size() > 1) {
-		map->getPoint(getTail()).setType(Point::Type::SNAKE_TAIL);
+		map->setPointType(getTail(), Point::Type::SNAKE_TAIL);
 	}
 }
 
-void Snake::findMinPathToFood(list<Direction> &path) {
+void Snake::beginSimulation() {
+	map->beginTransaction();
+	simulating = true;
+	simMoves.clear();
+	simDirec = direc;
+	simDead = dead;
+}
+
+void Snake::rollbackSimulation() {
+	// Undo the moves in reverse order
+	for (auto it = simMoves.rbegin(); it != simMoves.rend(); ++it) {
+		if (*it != NO_TAIL) {
+			bodies.pushBack(*it);
+		}
+		bodies.popFront();
+	}
+	simMoves.clear();
+	direc = simDirec;
+	dead = simDead;
+	simulating = false;
+	map->rollback();
+}
+
+void Snake::findMinPathToFood(PathBuffer &path) {
 	findPathTo(0, map->getFood(), path);
 }
 
-void Snake::findMaxPathToTail(list<Direction> &path) {
+void Snake::findMaxPathToTail(PathBuffer &path) {
 	findPathTo(1, getTail(), path);
 }
 
-void Snake::findPathTo(const int pathType, const Pos &goal, list<Direction> &path) {
+void Snake::findPathTo(const int pathType, const Pos &goal, PathBuffer &path) {
 	Point::Type oriType = map->getPoint(goal).getType();
-	map->getPoint(goal).setType(Point::Type::EMPTY);
+	map->setPointType(goal, Point::Type::EMPTY);
 	if (pathType == 0) {
-		std::chrono::system_clock::time_point beginTime = std::chrono::system_clock::now();
 		if (threaded) {
 			findMinPathThreaded(getHead(), goal, path);
 		}
+		else if (bitboard) {
+			findMinPathBitboard(getHead(), goal, path);
+		}
+		else if (astar) {
+			findMinPathAStar(getHead(), goal, path);
+		}
+		else if (jps) {
+			findMinPathJPS(getHead(), goal, path);
+		}
+		else if (hybrid) {
+			findMinPathHybrid(getHead(), goal, path);
+		}
 		else {
 			findMinPath(getHead(), goal, path);
 		}
-		std::chrono::system_clock::time_point endTime = std::chrono::system_clock::now();
-		std::chrono::duration<double> elapsed_seconds = endTime - beginTime;
-		if (maxTimeBFS < elapsed_seconds.count()) {
-			maxTimeBFS = elapsed_seconds.count();
-		}
-		totalTimeBFS += elapsed_seconds.count();
 	}
 	else if (pathType == 1) {
-		std::chrono::system_clock::time_point beginTime = std::chrono::system_clock::now();
-		if (threaded) {
+		if (exactMaxPath) {
+			findMaxPathExact(getHead(), goal, path);
+		}
+		else if (threaded) {
 			findMaxPathThreaded(getHead(), goal, path);
 		}
 		else {
 			findMaxPath(getHead(), goal, path);
 		}
-		std::chrono::system_clock::time_point endTime = std::chrono::system_clock::now();
-		std::chrono::duration<double> elapsed_seconds = endTime - beginTime;
-		if (maxTimeGraphSearch < elapsed_seconds.count()) {
-			maxTimeGraphSearch = elapsed_seconds.count();
-		}
-		totalTimeGraphSearch += elapsed_seconds.count();
 	}
-	map->getPoint(goal).setType(oriType);  // Retore point type
+	map->setPointType(goal, oriType);  // Retore point type
 }
-/********************************************************************************************************************
-FOR THE PROFESSOR: THE FOLLOWING IS THE THREADED IMPLEMENTATION OF THE BFS
-Basically the only code I ended up adding was the OpenMP stuff.
-A lot of testing was done before this, as can be seen by the commits on our github, but in the end, the solution
-ended up being fairly simple.
-*********************************************************************************************************************/
-void Snake::findMinPathThreaded(const Pos &from, const Pos &to, list<Direction> &path) {
+
+void Snake::findMinPathThreaded(const Pos &from, const Pos &to, PathBuffer &path) {
+	static const Direction ADJ_DIRECS[4] = {LEFT, UP, RIGHT, DOWN};
 	// Init
-	SizeType row = map->getRowCount(), col = map->getColCount();
-	for (SizeType i = 1; i < row - 1; ++i) {
-		for (SizeType j = 1; j < col - 1; ++j) {
-			map->getPoint(Pos(i, j)).setDist(Point::MAX_VALUE);
-		}
-	}
+	map->beginSearch();
 	path.clear();
-	map->getPoint(from).setDist(0);
+	SizeType fromIdx = map->getIndex(from), toIdx = map->getIndex(to);
+	map->setDistAt(fromIdx, 0);
 
-	//Push first element to queue
-	queue<Pos> openList;
-	openList.push(from);
+	vector<SizeType> frontier(1, fromIdx), next, visited;
+	vector<vector<SizeType>> localNext(omp_get_max_threads());
+	vector<SizeType> offsets(localNext.size() + 1);
+	int numThreads = 1;
+	Point::ValueType level = 0;
+	bool found = (fromIdx == toIdx);
 
-
-	// BFS
-	while (!openList.empty()) {
-		int queueSize = openList.size();
-		//Make every iteration of the for loop a separate thread
-#pragma omp parallel for //Will happen every iteration of the while loop
-		for (int i = 0; i < queueSize; i++) {
-			Pos curPos;
-#pragma omp critical //Restrict access to queue to 1 thread at a time
-			{
-				curPos = openList.front();
-				openList.pop();
-			}
-			const Point &curPoint = map->getPoint(curPos);
-			map->showTestPos(curPos);
-			if (curPos == to) {
-				buildPath(from, to, path);
-				openList.empty();
-			}
-			vector<Pos> adjPositions = curPos.getAllAdj();
-			Random<>::getInstance()->shuffle(adjPositions.begin(), adjPositions.end());
-			// Arrange the order of traversing to make the result path as straight as possible
-			Direction bestDirec = (curPos == from ? direc : curPoint.getParent().getDirectionTo(curPos));
-			for (SizeType i = 0; i < adjPositions.size(); ++i) {
-				if (bestDirec == curPos.getDirectionTo(adjPositions[i])) {
-					util::swap(adjPositions[0], adjPositions[i]);
-					break;
+	// Level-synchronous BFS. Each level runs in three phases separated by
+	// barriers, so no point is written while another thread reads it:
+	//   1. Each thread claims the unvisited neighbours of its share of the
+	//      frontier with a compare-and-swap on their distance and collects
+	//      them in a local list.
+	//   2. The local lists are copied side by side into the next frontier
+	//      at offsets given by a prefix sum.
+	//   3. Each point of the next frontier picks its parent among its
+	//      neighbours on the current level, preferring the one it can be
+	//      reached from without turning. The choice only depends on the
+	//      levels, so the result is the same for any number of threads.
+	while (!found && !frontier.empty()) {
+		if (map->isTestEnabled()) {
+			visited.insert(visited.end(), frontier.begin(), frontier.end());
+		}
+		long frontierSize = (long)frontier.size();
+		expandedCnt += frontierSize;
+#pragma omp parallel
+		{
+			vector<SizeType> &local = localNext[omp_get_thread_num()];
+			local.clear();
+#pragma omp for schedule(static)
+			for (long i = 0; i < frontierSize; ++i) {
+				SizeType curIdx = frontier[i];
+				for (const Direction d : ADJ_DIRECS) {
+					SizeType adjIdx = map->getAdjIndex(curIdx, d);
+					if (map->isEmptyAt(adjIdx)
+						&& map->claimVisitAt(adjIdx)) {
+						map->getPointAt(adjIdx).setDist(level + 1);
+						local.push_back(adjIdx);
+					}
 				}
 			}
-
-			// Traverse the adjacent positions
-			/*
-			This was not parallelized due to the fact that there
-			was not much work being done in the for loop. Even in the 
-			max case (4), there would be no benefit. In fact, I suspect there
-			would be a detriment. Starting each thread, and waiting for them all
-			to finish would be slower than simply doing it sequentially.
-			*/
-			for (int j = 0; j < adjPositions.size(); j++) {
-				const Pos &adjPos = adjPositions.at(j);
-				Point &adjPoint = map->getPoint(adjPos);
-				if (map->isEmpty(adjPos) && adjPoint.getDist() == Point::MAX_VALUE) {
-					adjPoint.setParent(curPos);
-					adjPoint.setDist(curPoint.getDist() + 1);
-#pragma omp critical //Restrict access to queue to 1 thread at a time
-					openList.push(adjPos);
-				}
-				if (maxNumThreadsBFS < omp_get_num_threads()) {
-					maxNumThreadsBFS = omp_get_num_threads();
+#pragma omp single
+			{
+				numThreads = omp_get_num_threads();
+				for (int t = 0; t < numThreads; ++t) {
+					offsets[t + 1] = offsets[t] + localNext[t].size();
 				}
+				next.resize(offsets[numThreads]);
+			}
+			std::copy(local.begin(), local.end(), next.begin() + offsets[omp_get_thread_num()]);
+#pragma omp barrier
+			long nextSize = (long)next.size();
+#pragma omp for schedule(static)
+			for (long i = 0; i < nextSize; ++i) {
+				SizeType parentIdx = findStraightParent(next[i], fromIdx, level);
+				map->getPointAt(next[i]).setParent(map->getPos(parentIdx));
 			}
 		}
+		if (maxNumThreadsBFS < numThreads) {
+			maxNumThreadsBFS = numThreads;
+		}
+		frontier.swap(next);
+		found = (map->getDistAt(toIdx) == ++level);
+	}
+
+	for (const SizeType idx : visited) {
+		map->showTestPos(map->getPos(idx));
+	}
+	if (found) {
+		buildPath(from, to, path);
 	}
 }
 
-void Snake::findMinPath(const Pos &from, const Pos &to, list<Direction> &path) {
+void Snake::findMinPath(const Pos &from, const Pos &to, PathBuffer &path) {
 	// Init
-	SizeType row = map->getRowCount(), col = map->getColCount();
-	for (SizeType i = 1; i < row - 1; ++i) {
-		for (SizeType j = 1; j < col - 1; ++j) {
-			map->getPoint(Pos(i, j)).setDist(Point::MAX_VALUE);
-		}
-	}
+	map->beginSearch();
 	path.clear();
-	map->getPoint(from).setDist(0);
-	queue<Pos> openList;
-	openList.push(from);
+	SizeType fromIdx = map->getIndex(from), toIdx = map->getIndex(to);
+	map->setDistAt(fromIdx, 0);
+	queue<SizeType> openList;
+	openList.push(fromIdx);
 
 	// BFS
 	while (!openList.empty()) {
-		Pos curPos = openList.front();
-		const Point &curPoint = map->getPoint(curPos);
+		SizeType curIdx = openList.front();
+		const Point &curPoint = map->getPointAt(curIdx);
+		Pos curPos = map->getPos(curIdx);
 		openList.pop();
+		++expandedCnt;
 		map->showTestPos(curPos);
-		if (curPos == to) {
+		if (curIdx == toIdx) {
 			buildPath(from, to, path);
 			break;
 		}
-		vector<Pos> adjPositions = curPos.getAllAdj();
-		Random<>::getInstance()->shuffle(adjPositions.begin(), adjPositions.end());
+		Direction adjDirecs[4] = {LEFT, UP, RIGHT, DOWN};
+		random.shuffle(adjDirecs, adjDirecs + 4);
 		// Arrange the order of traversing to make the result path as straight as possible
-		Direction bestDirec = (curPos == from ? direc : curPoint.getParent().getDirectionTo(curPos));
-		for (SizeType i = 0; i < adjPositions.size(); ++i) {
-			if (bestDirec == curPos.getDirectionTo(adjPositions[i])) {
-				util::swap(adjPositions[0], adjPositions[i]);
+		Direction bestDirec = (curIdx == fromIdx ? direc : curPoint.getParent().getDirectionTo(curPos));
+		for (SizeType i = 0; i < 4; ++i) {
+			if (bestDirec == adjDirecs[i]) {
+				util::swap(adjDirecs[0], adjDirecs[i]);
 				break;
 			}
 		}
 
-		// Traverse the adjacent positions
-
-		for (const Pos &adjPos : adjPositions) {
-			Point &adjPoint = map->getPoint(adjPos);
-			if (map->isEmpty(adjPos) && adjPoint.getDist() == Point::MAX_VALUE) {
+		// Traverse the adjacent positions. The boundary walls are never
+		// empty, so the adjacent indices need no bounds check.
+		for (const Direction d : adjDirecs) {
+			SizeType adjIdx = map->getAdjIndex(curIdx, d);
+			Point &adjPoint = map->getPointAt(adjIdx);
+			if (map->isEmptyAt(adjIdx) && !map->isVisitAt(adjIdx)) {
 				adjPoint.setParent(curPos);
-				adjPoint.setDist(curPoint.getDist() + 1);
-				openList.push(adjPos);
+				map->setDistAt(adjIdx, curPoint.getDist() + 1);
+				openList.push(adjIdx);
 			}
 			if (maxNumThreadsBFS < omp_get_num_threads()) {
 				maxNumThreadsBFS = omp_get_num_threads();
@@ -446,219 +527,586 @@ void Snake::findMinPath(const Pos &from, const Pos &to, list<Direction> &path) {
 	}
 }
 
-void Snake::findMaxPath(const Pos &from, const Pos &to, list<Direction> &path) {
-	// Get the shortest path
-	bool oriEnabled = map->isTestEnabled();
-	map->setTestEnabled(false);
-	findMinPath(from, to, path);
-	map->setTestEnabled(oriEnabled);
-	// Init
+void Snake::findMinPathBitboard(const Pos &from, const Pos &to, PathBuffer &path) {
+	typedef Bitboard::WordType WordType;
+	const SizeType WORD_BITS = Bitboard::WORD_BITS;
+	path.clear();
+	SizeType fromIdx = map->getIndex(from), toIdx = map->getIndex(to);
 	SizeType row = map->getRowCount(), col = map->getColCount();
-	for (SizeType i = 1; i < row - 1; ++i) {
-		for (SizeType j = 1; j < col - 1; ++j) {
-			map->getPoint(Pos(i, j)).setVisit(false);
+	Bitboard frontier(row, col);
+	SizeType wordCnt = frontier.getWordCount(), reach = frontier.getReach();
+	const WordType *emptyWords = map->getEmptyBits().getWords();
+	vector<WordType> unvisited(emptyWords, emptyWords + wordCnt);
+	vector<WordType> next(wordCnt);
+	unvisited[fromIdx / WORD_BITS] &= ~((WordType)1 << (fromIdx % WORD_BITS));
+
+	// The frontier of level d is stored as its non-zero words
+	// [levelBeg[d], levelBeg[d + 1]) of levelWords, starting at word levelLo[d]
+	vector<WordType> levelWords;
+	vector<SizeType> levelLo, levelBeg;
+	SizeType lo = fromIdx / WORD_BITS, hi = lo + 1;
+	frontier.set(fromIdx);
+	levelLo.push_back(lo);
+	levelBeg.push_back(0);
+	levelWords.push_back(frontier.getWords()[lo]);
+	levelBeg.push_back(levelWords.size());
+
+	// BFS
+	bool found = (fromIdx == toIdx);
+	while (!found) {
+		SizeType beg = lo > reach ? lo - reach : 0;
+		SizeType end = std::min(hi + reach, wordCnt);
+		frontier.expand(beg, end, unvisited.data() + beg, next.data());
+		frontier.clear(lo, hi);
+		// Trim the zero words at both ends
+		SizeType nlo = beg, nhi = end;
+		while (nlo < nhi && !next[nlo - beg]) {
+			++nlo;
+		}
+		while (nhi > nlo && !next[nhi - 1 - beg]) {
+			--nhi;
 		}
+		if (nlo == nhi) {
+			return;  // Unreachable
+		}
+		WordType *frontierWords = frontier.getWords();
+		levelLo.push_back(nlo);
+		for (SizeType w = nlo; w < nhi; ++w) {
+			WordType bits = next[w - beg];
+			frontierWords[w] = bits;
+			unvisited[w] &= ~bits;
+			levelWords.push_back(bits);
+			expandedCnt += util::popCount(bits);
+		}
+		levelBeg.push_back(levelWords.size());
+		lo = nlo;
+		hi = nhi;
+		found = frontier.test(toIdx);
 	}
-	// Make all points on the path visited
-	Pos cur = from;
-	for (const Direction d : path) {
-		map->getPoint(cur).setVisit(true);
-		cur = cur.getAdj(d);
+	frontier.clear(lo, hi);
+
+	// Keep only the points that lie on a shortest path to the goal
+	SizeType depth = levelLo.size() - 1;
+	for (SizeType w = levelBeg[depth]; w < levelBeg[depth + 1]; ++w) {
+		levelWords[w] = 0;
 	}
-	map->getPoint(cur).setVisit(true);
-	// Extend the path between each pair of the points
-	for (auto it = path.begin(); it != path.end();) {
-		if (it == path.begin()) {
-			cur = from;
-		}
-		bool extended = false;
-		Direction curDirec = *it;
-		Pos next = cur.getAdj(curDirec);
-		switch (curDirec) {
-		case LEFT:
-		case RIGHT: {
-			Pos curUp = cur.getAdj(UP);
-			Pos nextUp = next.getAdj(UP);
-			// Check two points above
-			if (map->isEmptyNotVisit(curUp) && map->isEmptyNotVisit(nextUp)) {
-				map->getPoint(curUp).setVisit(true);
-				map->getPoint(nextUp).setVisit(true);
-				it = path.erase(it);
-				it = path.insert(it, DOWN);
-				it = path.insert(it, curDirec);
-				it = path.insert(it, UP);
-				it = path.begin();
-				extended = true;
+	levelWords[levelBeg[depth] + toIdx / WORD_BITS - levelLo[depth]] = (WordType)1 << (toIdx % WORD_BITS);
+	WordType *frontierWords = frontier.getWords();
+	for (SizeType d = depth; d-- > 0;) {
+		SizeType nextLo = levelLo[d + 1], nextCnt = levelBeg[d + 2] - levelBeg[d + 1];
+		std::copy(levelWords.begin() + levelBeg[d + 1], levelWords.begin() + levelBeg[d + 2], frontierWords + nextLo);
+		WordType *curWords = levelWords.data() + levelBeg[d];
+		frontier.expand(levelLo[d], levelLo[d] + (levelBeg[d + 1] - levelBeg[d]), curWords, curWords);
+		frontier.clear(nextLo, nextLo + nextCnt);
+	}
+
+	// Walk from the start, going straight whenever the next level allows it
+	SizeType cur = fromIdx;
+	Direction lastDirec = direc;
+	for (SizeType d = 1; d <= depth; ++d) {
+		Direction order[5] = {lastDirec, LEFT, UP, RIGHT, DOWN};
+		for (const Direction adjDirec : order) {
+			if (adjDirec == NONE) {
+				continue;
 			}
-			else {
-				Pos curDown = cur.getAdj(DOWN);
-				Pos nextDown = next.getAdj(DOWN);
-				// Check two points below
-				if (map->isEmptyNotVisit(curDown) && map->isEmptyNotVisit(nextDown)) {
-					map->getPoint(curDown).setVisit(true);
-					map->getPoint(nextDown).setVisit(true);
-					it = path.erase(it);
-					it = path.insert(it, UP);
-					it = path.insert(it, curDirec);
-					it = path.insert(it, DOWN);
-					it = path.begin();
-					extended = true;
-				}
+			SizeType adjIdx = map->getAdjIndex(cur, adjDirec);
+			SizeType w = adjIdx / WORD_BITS;
+			if (w >= levelLo[d] && w - levelLo[d] < levelBeg[d + 1] - levelBeg[d]
+				&& (levelWords[levelBeg[d] + w - levelLo[d]] >> (adjIdx % WORD_BITS)) & 1) {
+				path.push_back(adjDirec);
+				cur = adjIdx;
+				lastDirec = adjDirec;
+				break;
 			}
-			break;
 		}
-		case UP:
-		case DOWN: {
-			Pos curLeft = cur.getAdj(LEFT);
-			Pos nextLeft = next.getAdj(LEFT);
-			// Check two points on the left
-			if (map->isEmptyNotVisit(curLeft) && map->isEmptyNotVisit(nextLeft)) {
-				map->getPoint(curLeft).setVisit(true);
-				map->getPoint(nextLeft).setVisit(true);
-				it = path.erase(it);
-				it = path.insert(it, RIGHT);
-				it = path.insert(it, curDirec);
-				it = path.insert(it, LEFT);
-				it = path.begin();
-				extended = true;
+	}
+}
+
+void Snake::findMinPathHybrid(const Pos &from, const Pos &to, PathBuffer &path) {
+	// A level is expanded bottom-up when the frontier exceeds 1/ALPHA of the
+	// unvisited points. A grid point has at most four neighbours, so the
+	// bottom-up step only pays off once few points are left unvisited.
+	static const SizeType ALPHA = 2;
+	// Init
+	map->beginSearch();
+	path.clear();
+	SizeType fromIdx = map->getIndex(from), toIdx = map->getIndex(to);
+	map->setDistAt(fromIdx, 0);
+
+	vector<SizeType> frontier(1, fromIdx), next, unvisited, visited;
+	SizeType size = map->getSize();
+	SizeType unvisitedCnt = size > bodies.size() ? size - bodies.size() : 0;
+	bool unvisitedBuilt = false;
+	Point::ValueType level = 0;
+	bool found = (fromIdx == toIdx);
+
+	while (!found && !frontier.empty()) {
+		if (map->isTestEnabled()) {
+			visited.insert(visited.end(), frontier.begin(), frontier.end());
+		}
+		expandedCnt += frontier.size();
+		bool bottomUp = frontier.size() * ALPHA > unvisitedCnt;
+		next.clear();
+		if (bottomUp) {
+			// Collect the unvisited points once, then drop the visited ones level by level
+			if (!unvisitedBuilt) {
+				SizeType row = map->getRowCount(), col = map->getColCount();
+				for (SizeType i = 1; i < row - 1; ++i) {
+					for (SizeType j = 1; j < col - 1; ++j) {
+						SizeType idx = i * col + j;
+						if (map->isEmptyNotVisitAt(idx)) {
+							unvisited.push_back(idx);
+						}
+					}
+				}
+				unvisitedBuilt = true;
 			}
-			else {
-				Pos curRight = cur.getAdj(RIGHT);
-				Pos nextRight = next.getAdj(RIGHT);
-				// Check two points on the right
-				if (map->isEmptyNotVisit(curRight) && map->isEmptyNotVisit(nextRight)) {
-					map->getPoint(curRight).setVisit(true);
-					map->getPoint(nextRight).setVisit(true);
-					it = path.erase(it);
-					it = path.insert(it, LEFT);
-					it = path.insert(it, curDirec);
-					it = path.insert(it, RIGHT);
-					it = path.begin();
-					extended = true;
+			SizeType remain = 0;
+			for (const SizeType idx : unvisited) {
+				if (map->isVisitAt(idx)) {
+					continue;  // Visited by a top-down level
+				}
+				SizeType parentIdx = findStraightParent(idx, fromIdx, level);
+				if (parentIdx) {
+					map->setDistAt(idx, level + 1);
+					map->getPointAt(idx).setParent(map->getPos(parentIdx));
+					next.push_back(idx);
+				} else {
+					unvisited[remain++] = idx;
+				}
+			}
+			unvisited.resize(remain);
+		} else {
+			for (const SizeType curIdx : frontier) {
+				const Point &curPoint = map->getPointAt(curIdx);
+				Pos curPos = map->getPos(curIdx);
+				Direction bestDirec = (curIdx == fromIdx ? direc : curPoint.getParent().getDirectionTo(curPos));
+				Direction adjDirecs[5] = {bestDirec, LEFT, UP, RIGHT, DOWN};
+				for (const Direction d : adjDirecs) {
+					if (d == NONE) {
+						continue;
+					}
+					SizeType adjIdx = map->getAdjIndex(curIdx, d);
+					Point &adjPoint = map->getPointAt(adjIdx);
+					if (map->isEmptyAt(adjIdx) && !map->isVisitAt(adjIdx)) {
+						adjPoint.setParent(curPos);
+						map->setDistAt(adjIdx, level + 1);
+						next.push_back(adjIdx);
+					}
 				}
 			}
+		}
+		unvisitedCnt = unvisitedCnt > next.size() ? unvisitedCnt - next.size() : 0;
+		frontier.swap(next);
+		found = (map->getDistAt(toIdx) == ++level);
+	}
+
+	for (const SizeType idx : visited) {
+		map->showTestPos(map->getPos(idx));
+	}
+	if (found) {
+		buildPath(from, to, path);
+	}
+}
+
+void Snake::findMinPathAStar(const Pos &from, const Pos &to, PathBuffer &path) {
+	// Init
+	map->beginSearch();
+	path.clear();
+	SizeType fromIdx = map->getIndex(from), toIdx = map->getIndex(to);
+	map->setDistAt(fromIdx, 0);
+
+	// Each step changes the Manhattan distance to the goal by one, so the
+	// estimate f = g + h of a neighbour is either f or f + 2. Bucket k holds
+	// the points with f = h(from) + 2k, and f never decreases.
+	vector<vector<SizeType>> buckets(1, vector<SizeType>(1, fromIdx));
+	Point::ValueType fromH = (Point::ValueType)Map::distance(from, to);
+	SizeType cur = 0;
+	while (cur < buckets.size()) {
+		if (buckets[cur].empty()) {
+			++cur;
+			continue;
+		}
+		SizeType curIdx = buckets[cur].back();
+		buckets[cur].pop_back();
+		const Point &curPoint = map->getPointAt(curIdx);
+		Pos curPos = map->getPos(curIdx);
+		Point::ValueType g = curPoint.getDist();
+		if (g + Map::distance(curPos, to) != fromH + 2 * cur) {
+			continue;  // Reached again with a shorter distance
+		}
+		++expandedCnt;
+		map->showTestPos(curPos);
+		if (curIdx == toIdx) {
+			buildPath(from, to, path);
 			break;
 		}
-		default:
+
+		// Push the straight direction last so that it is expanded first
+		Direction bestDirec = (curIdx == fromIdx ? direc : curPoint.getParent().getDirectionTo(curPos));
+		Direction adjDirecs[5] = {DOWN, RIGHT, UP, LEFT, bestDirec};
+		for (SizeType i = 0; i < 5; ++i) {
+			Direction d = adjDirecs[i];
+			if (d == NONE || (i < 4 && d == bestDirec)) {
+				continue;
+			}
+			SizeType adjIdx = map->getAdjIndex(curIdx, d);
+			if (!map->isEmptyAt(adjIdx) || map->getDistAt(adjIdx) <= g + 1) {
+				continue;
+			}
+			map->getPointAt(adjIdx).setParent(curPos);
+			map->setDistAt(adjIdx, g + 1);
+			SizeType f = g + 1 + Map::distance(map->getPos(adjIdx), to);
+			SizeType k = (f - fromH) / 2;
+			if (k >= buckets.size()) {
+				buckets.resize(k + 1);
+			}
+			buckets[k].push_back(adjIdx);
+		}
+	}
+}
+
+void Snake::findMinPathJPS(const Pos &from, const Pos &to, PathBuffer &path) {
+	// Init
+	map->beginSearch();
+	path.clear();
+	SizeType fromIdx = map->getIndex(from), toIdx = map->getIndex(to);
+	map->setDistAt(fromIdx, 0);
+
+	// A* on the jump points with the buckets of findMinPathAStar(). A jump
+	// of length L changes the Manhattan distance to the goal by at most L
+	// and with the same parity, so the estimate still grows by steps of 2.
+	vector<vector<SizeType>> buckets(1, vector<SizeType>(1, fromIdx));
+	Point::ValueType fromH = (Point::ValueType)Map::distance(from, to);
+	SizeType cur = 0;
+	bool found = false;
+	while (cur < buckets.size()) {
+		if (buckets[cur].empty()) {
+			++cur;
+			continue;
+		}
+		SizeType curIdx = buckets[cur].back();
+		buckets[cur].pop_back();
+		const Point &curPoint = map->getPointAt(curIdx);
+		Pos curPos = map->getPos(curIdx);
+		Point::ValueType g = curPoint.getDist();
+		if (g + Map::distance(curPos, to) != fromH + 2 * cur) {
+			continue;  // Reached again with a shorter distance
+		}
+		++expandedCnt;
+		map->showTestPos(curPos);
+		if (curIdx == toIdx) {
+			found = true;
 			break;
 		}
-		if (!extended) {
-			++it;
-			cur = next;
+
+		// A jump point reached horizontally only continues straight or turns
+		// vertically, and the other way round. The start tries all four
+		// directions. The straight direction is pushed last to be tried first.
+		Direction inDirec = NONE;
+		if (curIdx != fromIdx) {
+			Pos parent = curPoint.getParent();
+			inDirec = parent.getX() == curPos.getX() ? (parent.getY() < curPos.getY() ? RIGHT : LEFT)
+				: (parent.getX() < curPos.getX() ? DOWN : UP);
+		}
+		Direction bestDirec = (curIdx == fromIdx ? direc : inDirec);
+		Direction adjDirecs[5] = {DOWN, RIGHT, UP, LEFT, bestDirec};
+		for (SizeType i = 0; i < 5; ++i) {
+			Direction d = adjDirecs[i];
+			if (d == NONE || (i < 4 && d == bestDirec)) {
+				continue;
+			}
+			bool horizontal = (d == LEFT || d == RIGHT);
+			bool inHorizontal = (inDirec == LEFT || inDirec == RIGHT);
+			if (inDirec != NONE && horizontal == inHorizontal && d != inDirec) {
+				continue;  // Never go back
+			}
+			SizeType jumpIdx = findJumpPoint(map->getAdjIndex(curIdx, d), d, toIdx);
+			if (!jumpIdx) {
+				continue;
+			}
+			Pos jumpPos = map->getPos(jumpIdx);
+			Point::ValueType jumpG = g + (Point::ValueType)Map::distance(curPos, jumpPos);
+			if (map->getDistAt(jumpIdx) <= jumpG) {
+				continue;
+			}
+			map->getPointAt(jumpIdx).setParent(curPos);
+			map->setDistAt(jumpIdx, jumpG);
+			SizeType k = (jumpG + Map::distance(jumpPos, to) - fromH) / 2;
+			if (k >= buckets.size()) {
+				buckets.resize(k + 1);
+			}
+			buckets[k].push_back(jumpIdx);
 		}
 	}
-	if (maxNumThreadsGraphSearch < omp_get_num_threads()) {
-		maxNumThreadsGraphSearch = omp_get_num_threads();
+
+	// Fill in the straight runs between the jump points
+	if (found) {
+		Pos pos = to;
+		while (!(pos == from)) {
+			Pos parent = map->getPointAt(map->getIndex(pos)).getParent();
+			Direction d = parent.getX() == pos.getX() ? (parent.getY() < pos.getY() ? RIGHT : LEFT)
+				: (parent.getX() < pos.getX() ? DOWN : UP);
+			path.push_front(d, Map::distance(parent, pos));
+			pos = parent;
+		}
+	}
+}
+
+Snake::SizeType Snake::findJumpPoint(SizeType idx, const Direction d, const SizeType toIdx) const {
+	static const Direction OPPOSITE[5] = {NONE, RIGHT, DOWN, LEFT, UP};
+	bool horizontal = (d == LEFT || d == RIGHT);
+	Direction side1 = horizontal ? UP : LEFT, side2 = horizontal ? DOWN : RIGHT;
+	while (map->isEmptyAt(idx)) {
+		if (idx == toIdx) {
+			return idx;
+		}
+		SizeType backIdx = map->getAdjIndex(idx, OPPOSITE[d]);
+		if ((map->isEmptyAt(map->getAdjIndex(idx, side1)) && !map->isEmptyAt(map->getAdjIndex(backIdx, side1)))
+			|| (map->isEmptyAt(map->getAdjIndex(idx, side2)) && !map->isEmptyAt(map->getAdjIndex(backIdx, side2)))) {
+			return idx;  // Forced neighbour
+		}
+		if (!horizontal && (findJumpPoint(map->getAdjIndex(idx, LEFT), LEFT, toIdx)
+							|| findJumpPoint(map->getAdjIndex(idx, RIGHT), RIGHT, toIdx))) {
+			return idx;
+		}
+		idx = map->getAdjIndex(idx, d);
 	}
+	return 0;
 }
 
-void Snake::findMaxPathThreaded(const Pos &from, const Pos &to, list<Direction> &path) {
+Snake::SizeType Snake::findStraightParent(const SizeType idx, const SizeType fromIdx,
+										  const Point::ValueType level) const {
+	static const Direction ADJ_DIRECS[4] = {LEFT, UP, RIGHT, DOWN};
+	static const Direction OPPOSITE[5] = {NONE, RIGHT, DOWN, LEFT, UP};
+	SizeType parentIdx = 0;
+	for (const Direction d : ADJ_DIRECS) {
+		SizeType adjIdx = map->getAdjIndex(idx, d);
+		bool onLevel = (level == 0 ? adjIdx == fromIdx
+			: map->isEmptyAt(adjIdx) && map->getDistAt(adjIdx) == level);
+		if (!onLevel) {
+			continue;
+		}
+		// The neighbour was reached without turning if its own parent lies
+		// one more step away in the same direction
+		bool straight = (adjIdx == fromIdx ? direc == OPPOSITE[d]
+			: map->getIndex(map->getPointAt(adjIdx).getParent()) == map->getAdjIndex(adjIdx, d));
+		if (straight) {
+			return adjIdx;
+		}
+		if (!parentIdx) {
+			parentIdx = adjIdx;
+		}
+	}
+	return parentIdx;
+}
+
+void Snake::findMaxPath(const Pos &from, const Pos &to, PathBuffer &path) {
 	// Get the shortest path
 	bool oriEnabled = map->isTestEnabled();
 	map->setTestEnabled(false);
 	findMinPath(from, to, path);
 	map->setTestEnabled(oriEnabled);
 	// Init
-	SizeType row = map->getRowCount(), col = map->getColCount();
-	for (SizeType i = 1; i < row - 1; ++i) {
-		for (SizeType j = 1; j < col - 1; ++j) {
-			map->getPoint(Pos(i, j)).setVisit(false);
+	map->beginSearch();
+	// Make all points on the path visited
+	SizeType fromIdx = map->getIndex(from);
+	SizeType cur = fromIdx;
+	for (const Direction d : path) {
+		map->setVisitAt(cur);
+		cur = map->getAdjIndex(cur, d);
+	}
+	map->setVisitAt(cur);
+	extendPath(fromIdx, path);
+	if (maxNumThreadsGraphSearch < omp_get_num_threads()) {
+		maxNumThreadsGraphSearch = omp_get_num_threads();
+	}
+}
+
+void Snake::extendPath(const SizeType fromIdx, PathBuffer &path) {
+	PathBuffer done;
+	done.reserve(map->getSize());
+	extendSteps(fromIdx, path, 0, path.size(), 0, map->getRowCount() * map->getColCount(), done);
+	path = std::move(done);
+}
+
+void Snake::extendSteps(SizeType cur, const PathBuffer &steps, const SizeType beg, const SizeType end,
+						const SizeType lo, const SizeType hi, PathBuffer &out) {
+	static const Direction OPPOSITE[5] = {NONE, RIGHT, DOWN, LEFT, UP};
+	// Steps still to check, the next one first. A step is replaced by a
+	// detour of three steps over two empty points on one of its sides, and
+	// the detour is checked next. The earlier steps are not checked again:
+	// the points only get visited, so a step that could not be extended
+	// never can be.
+	PathBuffer pending;
+	pending.append(steps, beg, end);
+	while (!pending.empty()) {
+		Direction d = pending.front();
+		pending.pop_front();
+		SizeType next = map->getAdjIndex(cur, d);
+		// The boundary walls are never empty, so the side points need no bounds check
+		Direction sides[2] = {UP, DOWN};
+		if (d == UP || d == DOWN) {
+			sides[0] = LEFT;
+			sides[1] = RIGHT;
+		}
+		Direction side = NONE;
+		for (const Direction s : sides) {
+			SizeType curSide = map->getAdjIndex(cur, s), nextSide = map->getAdjIndex(next, s);
+			if (curSide >= lo && curSide < hi && nextSide >= lo && nextSide < hi
+				&& map->isEmptyNotVisitAt(curSide) && map->isEmptyNotVisitAt(nextSide)) {
+				map->setVisitAt(curSide);
+				map->setVisitAt(nextSide);
+				side = s;
+				break;
+			}
+		}
+		if (side != NONE) {
+			pending.push_front(OPPOSITE[side]);
+			pending.push_front(d);
+			pending.push_front(side);
+		} else {
+			out.push_back(d);
+			cur = next;
 		}
 	}
+}
+
+void Snake::findMaxPathThreaded(const Pos &from, const Pos &to, PathBuffer &path) {
+	// Rows per stripe. It does not depend on the number of threads, so the
+	// result is the same for any number of threads.
+	static const SizeType STRIPE_ROWS = 4;
+	// Get the shortest path
+	bool oriEnabled = map->isTestEnabled();
+	map->setTestEnabled(false);
+	findMinPath(from, to, path);
+	map->setTestEnabled(oriEnabled);
+	// Init
+	map->beginSearch();
 	// Make all points on the path visited
-	Pos cur = from;
+	SizeType fromIdx = map->getIndex(from);
+	SizeType cur = fromIdx;
 	for (const Direction d : path) {
-		map->getPoint(cur).setVisit(true);
-		cur = cur.getAdj(d);
+		map->setVisitAt(cur);
+		cur = map->getAdjIndex(cur, d);
 	}
-	map->getPoint(cur).setVisit(true);
-	// Extend the path between each pair of the points
-	for (auto it = path.begin(); it != path.end();) {
-		if (it == path.begin()) {
-			cur = from;
-		}
-		bool extended = false;
-		Direction curDirec = *it;
-		Pos next = cur.getAdj(curDirec);
-		switch (curDirec) {
-		case LEFT:
-		case RIGHT: {
-			Pos curUp = cur.getAdj(UP);
-			Pos nextUp = next.getAdj(UP);
-			// Check two points above
-			if (map->isEmptyNotVisit(curUp) && map->isEmptyNotVisit(nextUp)) {
-				map->getPoint(curUp).setVisit(true);
-				map->getPoint(nextUp).setVisit(true);
-				it = path.erase(it);
-				it = path.insert(it, DOWN);
-				it = path.insert(it, curDirec);
-				it = path.insert(it, UP);
-				it = path.begin();
-				extended = true;
-			}
-			else {
-				Pos curDown = cur.getAdj(DOWN);
-				Pos nextDown = next.getAdj(DOWN);
-				// Check two points below
-				if (map->isEmptyNotVisit(curDown) && map->isEmptyNotVisit(nextDown)) {
-					map->getPoint(curDown).setVisit(true);
-					map->getPoint(nextDown).setVisit(true);
-					it = path.erase(it);
-					it = path.insert(it, UP);
-					it = path.insert(it, curDirec);
-					it = path.insert(it, DOWN);
-					it = path.begin();
-					extended = true;
-				}
-			}
-			break;
+	map->setVisitAt(cur);
+
+	// Split the path into pieces that stay in one stripe of rows. A piece
+	// only takes side points in its own stripe, so the stripes can be
+	// extended in parallel without sharing any point. The steps between
+	// two stripes are left as they are for now.
+	struct Piece {
+		SizeType beg, end;  // Range of the piece in steps
+		SizeType fromIdx;   // Index of the start of the piece
+	};
+	SizeType indexCnt = map->getRowCount() * map->getColCount();
+	SizeType stripeSize = STRIPE_ROWS * map->getColCount();
+	SizeType stripeCnt = (indexCnt + stripeSize - 1) / stripeSize;
+	vector<Piece> pieces;
+	vector<vector<SizeType>> stripePieces(stripeCnt);  // Pieces of each stripe in path order
+	cur = fromIdx;
+	for (SizeType i = 0; i < path.size();) {
+		Piece piece = {i, i, cur};
+		SizeType stripe = cur / stripeSize;
+		while (i < path.size() && map->getAdjIndex(cur, path[i]) / stripeSize == stripe) {
+			cur = map->getAdjIndex(cur, path[i++]);
 		}
-		case UP:
-		case DOWN: {
-			Pos curLeft = cur.getAdj(LEFT);
-			Pos nextLeft = next.getAdj(LEFT);
-			// Check two points on the left
-			if (map->isEmptyNotVisit(curLeft) && map->isEmptyNotVisit(nextLeft)) {
-				map->getPoint(curLeft).setVisit(true);
-				map->getPoint(nextLeft).setVisit(true);
-				it = path.erase(it);
-				it = path.insert(it, RIGHT);
-				it = path.insert(it, curDirec);
-				it = path.insert(it, LEFT);
-				it = path.begin();
-				extended = true;
-			}
-			else {
-				Pos curRight = cur.getAdj(RIGHT);
-				Pos nextRight = next.getAdj(RIGHT);
-				// Check two points on the right
-				if (map->isEmptyNotVisit(curRight) && map->isEmptyNotVisit(nextRight)) {
-					map->getPoint(curRight).setVisit(true);
-					map->getPoint(nextRight).setVisit(true);
-					it = path.erase(it);
-					it = path.insert(it, LEFT);
-					it = path.insert(it, curDirec);
-					it = path.insert(it, RIGHT);
-					it = path.begin();
-					extended = true;
-				}
-			}
-			break;
+		piece.end = i;
+		if (piece.end > piece.beg) {
+			stripePieces[stripe].push_back(pieces.size());
+			pieces.push_back(piece);
 		}
-		default:
-			break;
+		if (i < path.size()) {
+			cur = map->getAdjIndex(cur, path[i++]);  // Into the next stripe
 		}
-		if (!extended) {
-			++it;
-			cur = next;
+	}
+
+	vector<PathBuffer> extended(pieces.size());
+	long cnt = (long)stripeCnt;
+	int numThreads = 1;
+#pragma omp parallel
+	{
+#pragma omp single nowait
+		numThreads = omp_get_num_threads();
+#pragma omp for schedule(dynamic)
+		for (long s = 0; s < cnt; ++s) {
+			SizeType lo = (SizeType)s * stripeSize, hi = std::min(lo + stripeSize, indexCnt);
+			for (const SizeType k : stripePieces[s]) {
+				const Piece &piece = pieces[k];
+				extendSteps(piece.fromIdx, path, piece.beg, piece.end, lo, hi, extended[k]);
+			}
 		}
 	}
-	if (maxNumThreadsGraphSearch < omp_get_num_threads()) {
-		maxNumThreadsGraphSearch = omp_get_num_threads();
+	if (maxNumThreadsGraphSearch < numThreads) {
+		maxNumThreadsGraphSearch = numThreads;
+	}
+
+	// Stitch the extended pieces and the steps between the stripes, and
+	// extend the result once more for the points along the stripe borders
+	PathBuffer stitched, done;
+	stitched.reserve(map->getSize());
+	SizeType last = 0;
+	for (SizeType k = 0; k < pieces.size(); ++k) {
+		stitched.append(path, last, pieces[k].beg);
+		stitched.splice(stitched.size(), extended[k]);
+		last = pieces[k].end;
 	}
+	stitched.append(path, last, path.size());
+	done.reserve(map->getSize());
+	extendSteps(fromIdx, stitched, 0, stitched.size(), 0, indexCnt, done);
+	path = std::move(done);
 }
 
-void Snake::buildPath(const Pos &from, const Pos &to, list<Direction> &path) const {
+void Snake::findMaxPathExact(const Pos &from, const Pos &to, PathBuffer &path) {
+	// The heuristic path is the one to beat, and the answer if the search
+	// runs out of its budget
+	if (threaded) {
+		findMaxPathThreaded(from, to, path);
+	}
+	else {
+		findMaxPath(from, to, path);
+	}
+	if (path.empty()) {
+		return;  // Unreachable
+	}
+	// Split the search over the threads only when the snake is threaded,
+	// so the path chosen among equally long ones stays deterministic
+	maxPathSolver.setThreadCount(threaded ? omp_get_max_threads() : 1);
+	PathBuffer longer;
+	maxPathSolver.solve(*map, map->getIndex(from), map->getIndex(to), path.size(), longer);
+	if (!longer.empty()) {
+		path = std::move(longer);
+	}
+}
+
+Direction Snake::findHamiltonShortcut() const {
+	static const Direction DIRECTIONS[4] = {LEFT, UP, RIGHT, DOWN};
+	Point::ValueType size = (Point::ValueType)map->getSize();
+	SizeType headIdx = bodies.front();
+	Pos food = map->getFood();
+	SizeType foodIdx = map->getIndex(food), headDist = Map::distance(map->getPos(headIdx), food);
+	Point::ValueType tailIndex = map->getPointAt(bodies.back()).getIdx();
+	Point::ValueType headIndex = util::getDistance(tailIndex, map->getPointAt(headIdx).getIdx(), size);
+	Point::ValueType foodIndex = util::getDistance(tailIndex, map->getPointAt(foodIdx).getIdx(), size);
+	Direction shortcut = NONE;
+	Point::ValueType maxIndex = headIndex;
+	for (const Direction d : DIRECTIONS) {
+		SizeType adjIdx = map->getAdjIndex(headIdx, d);
+		if ((!map->isEmptyAt(adjIdx) && adjIdx != foodIdx) || cycleNext[adjIdx] == NONE
+			|| Map::distance(map->getPos(adjIdx), food) >= headDist) {
+			continue;
+		}
+		Point::ValueType adjIndex = util::getDistance(tailIndex, map->getPointAt(adjIdx).getIdx(), size);
+		if (adjIndex > maxIndex && adjIndex <= foodIndex) {
+			maxIndex = adjIndex;
+			shortcut = d;
+		}
+	}
+	return shortcut;
+}
+
+void Snake::buildPath(const Pos &from, const Pos &to, PathBuffer &path) const {
 	Pos tmp = to, parent;
 	while (tmp != from) {
 		parent = map->getPoint(tmp).getParent();
@@ -668,28 +1116,40 @@ void Snake::buildPath(const Pos &from, const Pos &to, list<Direction> &path) con
 }
 
 void Snake::buildHamilton() {
-	// Change the initial body to a wall temporarily
-	Pos bodyPos = *(++bodies.begin());
-	Point &bodyPoint = map->getPoint(bodyPos);
-	map->getPoint(*(++bodies.begin())).setType(Point::Type::WALL);
+	// Change the initial body to a wall temporarily, and let the cycle
+	// pass through the food if there is one
+	Pos bodyPos = map->getPos(bodies[1]);
+	map->setPointType(bodyPos, Point::Type::WALL);
+	bool food = map->hasFood();
+	if (food) {
+		map->setPointType(map->getFood(), Point::Type::EMPTY);
+	}
 	// Get the longest path
 	bool oriEnabled = map->isTestEnabled();
 	map->setTestEnabled(false);
-	list<Direction> maxPath;
+	PathBuffer maxPath;
 	findMaxPathToTail(maxPath);
 	map->setTestEnabled(oriEnabled);
-	bodyPoint.setType(Point::Type::SNAKE_BODY);
+	map->setPointType(bodyPos, Point::Type::SNAKE_BODY);
+	if (food) {
+		map->setPointType(map->getFood(), Point::Type::FOOD);
+	}
 	// Initialize the first three incides of the cycle
 	Point::ValueType idx = 0;
-	for (auto it = bodies.crbegin(); it != bodies.crend(); ++it) {
-		map->getPoint(*it).setIdx(idx++);
+	for (SizeType i = bodies.size(); i-- > 0;) {
+		map->getPointAt(bodies[i]).setIdx(idx++);
 	}
 	// Build remaining cycle
 	SizeType size = map->getSize();
+	cycleNext.assign(map->getRowCount() * map->getColCount(), NONE);
+	for (SizeType i = bodies.size() - 1; i > 0; --i) {
+		cycleNext[bodies[i]] = map->getPos(bodies[i]).getDirectionTo(map->getPos(bodies[i - 1]));
+	}
 	Pos cur = getHead();
 	for (const Direction d : maxPath) {
 		Pos next = cur.getAdj(d);
 		map->getPoint(next).setIdx((map->getPoint(cur).getIdx() + 1) % size);
-		cur = next;
+		cycleNext[map->getIndex(cur)] = d;
+		cur = next;  // The path ends at the tail, closing the cycle
 	}
 }
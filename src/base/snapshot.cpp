@@ -0,0 +1,42 @@
+#include "base/snapshot.h"
+
+Snapshot::Snapshot() {}
+
+Snapshot::~Snapshot() {}
+
+void Snapshot::capture(const Map &map, const uint64_t seq_) {
+    rowCnt = map.getRowCount();
+    colCnt = map.getColCount();
+    seq = seq_;
+    SizeType size = rowCnt * colCnt;
+    types.resize(size);
+    dists.resize(size);
+    for (SizeType i = 0; i < size; ++i) {
+        const Point &point = map.getPointAt(i);
+        Point::Type type = point.getType();
+        types[i] = (uint8_t)type;
+        if (type == Point::Type::TEST_VISIT || type == Point::Type::TEST_PATH) {
+            dists[i] = point.getDist();
+        }
+    }
+}
+
+Snapshot::SizeType Snapshot::getRowCount() const {
+    return rowCnt;
+}
+
+Snapshot::SizeType Snapshot::getColCount() const {
+    return colCnt;
+}
+
+uint64_t Snapshot::getSeq() const {
+    return seq;
+}
+
+Point::Type Snapshot::getTypeAt(const SizeType idx) const {
+    return (Point::Type)types[idx];
+}
+
+Point::ValueType Snapshot::getDistAt(const SizeType idx) const {
+    return dists[idx];
+}
@@ -0,0 +1,112 @@
+#include "batch.h"
+#include "util/util.h"
+#include "util/threadpool.h"
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using std::vector;
+
+BatchRunner::BatchRunner() {}
+
+BatchRunner::~BatchRunner() {}
+
+void BatchRunner::setGameCount(const SizeType n) {
+    gameCnt = n;
+}
+
+void BatchRunner::setThreadCount(const SizeType n) {
+    threadCnt = n;
+}
+
+void BatchRunner::setSeed(const uint64_t s) {
+    seed = s;
+}
+
+void BatchRunner::setMapRow(const SizeType n) {
+    mapRowCnt = n;
+}
+
+void BatchRunner::setMapCol(const SizeType n) {
+    mapColCnt = n;
+}
+
+void BatchRunner::setEnableHamilton(const bool enableHamilton_) {
+    enableHamilton = enableHamilton_;
+}
+
+void BatchRunner::setThreaded(const bool threaded_) {
+    threaded = threaded_;
+}
+
+void BatchRunner::setMaxMoves(const SizeType n) {
+    maxMoves = n;
+}
+
+vector<GameResult> BatchRunner::run() const {
+    if (mapRowCnt < 5 || mapColCnt < 5) {
+        throw std::range_error("BatchRunner.run(): Map size at least 5*5.");
+    }
+    if (enableHamilton && mapRowCnt % 2 == 1 && mapColCnt % 2 == 1) {
+        throw std::range_error("BatchRunner.run(): Hamilton requires even amount of rows or columns.");
+    }
+    vector<GameResult> results(gameCnt);
+    SizeType cnt = threadCnt ? threadCnt : std::thread::hardware_concurrency();
+    util::ThreadPool pool(cnt);
+    for (SizeType i = 0; i < gameCnt; ++i) {
+        uint64_t gameSeed = seed + i;
+        GameResult *result = &results[i];
+        pool.submit([this, gameSeed, result] {
+            *result = runGame(gameSeed);
+        });
+    }
+    pool.wait();
+    return results;
+}
+
+GameResult BatchRunner::runGame(const uint64_t gameSeed) const {
+    typedef std::chrono::steady_clock Clock;
+    util::Random<> random(gameSeed);
+
+    Map map(mapRowCnt, mapColCnt);
+    Snake snake;
+    snake.setMap(&map);
+    snake.setSeed(random.next());
+    snake.addBody(Pos(1, 3));
+    snake.addBody(Pos(1, 2));
+    snake.addBody(Pos(1, 1));
+    if (enableHamilton) {
+        snake.enableHamilton();
+    }
+    if (threaded) {
+        snake.enableThreaded();
+    }
+    map.createRandFood(random);
+
+    GameResult result;
+    result.seed = gameSeed;
+    SizeType limit = maxMoves ? maxMoves : map.getSize() * map.getSize();
+    while (result.moves < limit) {
+        Clock::time_point begin = Clock::now();
+        snake.decideNext();
+        result.timeDecide += std::chrono::duration<double>(Clock::now() - begin).count();
+        if (map.isAllBody()) {
+            result.win = true;
+            break;
+        } else if (snake.isDead()) {
+            result.dead = true;
+            break;
+        }
+        snake.move();
+        ++result.moves;
+        if (!map.hasFood()) {
+            map.createRandFood(random);
+        }
+    }
+    result.length = snake.getLength();
+    result.timeBFS = (snake.getLatency(Snake::PHASE_HAMILTON_SHORTCUT).getTotal()
+                      + snake.getLatency(Snake::PHASE_FOOD_PATH).getTotal()) * 1e-9;
+    result.timeGraphSearch = (snake.getLatency(Snake::PHASE_TAIL_CHECK).getTotal()
+                              + snake.getLatency(Snake::PHASE_FOLLOW_TAIL).getTotal()) * 1e-9;
+    return result;
+}
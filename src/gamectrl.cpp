@@ -1,4 +1,5 @@
 #include "gamectrl.h"
+#include "batch.h"
 #include "util/util.h"
 #include <stdexcept>
 #include <cstdio>
@@ -6,13 +7,13 @@
 #include <chrono>
 #include <ctime>
 #include <cstdlib>
+#include <fstream>
 
 #ifdef OS_WIN
 #include <Windows.h>
 #endif
 
 using std::string;
-using std::list;
 using std::cout;
 using std::cin;
 using std::endl;
@@ -21,19 +22,15 @@ const string GameCtrl::MSG_BAD_ALLOC = "Not enough memory to run the game.";
 const string GameCtrl::MSG_LOSE = "Oops! You lose!";
 const string GameCtrl::MSG_WIN = "Congratulations! You Win!";
 const string GameCtrl::MSG_ESC = "Game ended.";
-const string GameCtrl::MAP_INFO_FILENAME = "movements.txt";
+const string GameCtrl::MAP_INFO_FILENAME = "movements.rec";
 
-GameCtrl::GameCtrl() {}
+GameCtrl::GameCtrl() : runMainThread(true), runSubThread(true) {}
 
 GameCtrl::~GameCtrl() {
     if (map) {
         delete map;
         map = nullptr;
     }
-    if (movementFile) {
-        fclose(movementFile);
-        movementFile = nullptr;
-    }
 }
 
 GameCtrl* GameCtrl::getInstance() {
@@ -73,6 +70,10 @@ void GameCtrl::setRecordMovements(const bool b) {
     recordMovements = b;
 }
 
+void GameCtrl::setRecordOverflow(const Recorder::Overflow overflow) {
+    recorder.setOverflow(overflow);
+}
+
 void GameCtrl::setRunTest(const bool b) {
     runTest = b;
 }
@@ -85,7 +86,34 @@ void GameCtrl::setMapCol(const SizeType n) {
     mapColCnt = n;
 }
 
+void GameCtrl::setSeed(const uint64_t s) {
+    seed = s;
+}
+
+void GameCtrl::setRunBatch(const SizeType games) {
+    batchGames = games;
+}
+
+void GameCtrl::setLatencyFile(const std::string &filename) {
+    latencyFile = filename;
+}
+
+const util::Histogram& GameCtrl::getLatency(const Snake::Phase phase) const {
+    return snake.getLatency(phase);
+}
+
+void GameCtrl::setRunReplay(const std::string &filename, const uint64_t fromTick) {
+    replayFile = filename;
+    replayStart = fromTick;
+}
+
 int GameCtrl::run() {
+    if (batchGames) {
+        return runBatch();
+    }
+    if (!replayFile.empty()) {
+        return runReplay();
+    }
     try {
         init();
         if (runTest) {
@@ -93,6 +121,7 @@ int GameCtrl::run() {
         } else {
             mainLoop();
         }
+        joinSubThreads();
 		bool finished = true;
 		while (finished) {
 			char g;
@@ -102,7 +131,7 @@ int GameCtrl::run() {
 				finished = false;
 				cout << endl << endl;
 				cout << "==================================================" << endl;
-				GameCtrl::run();
+				return GameCtrl::run();
 			}
 			else {
 				return 0;
@@ -110,55 +139,170 @@ int GameCtrl::run() {
 		}
     } catch (const std::exception &e) {
         exitGameErr(e.what());
+        joinSubThreads();
+        return -1;
+    }
+}
+
+int GameCtrl::runBatch() {
+    typedef std::chrono::steady_clock Clock;
+    try {
+        BatchRunner batch;
+        batch.setGameCount(batchGames);
+        batch.setSeed(seed);
+        batch.setMapRow(mapRowCnt);
+        batch.setMapCol(mapColCnt);
+        batch.setEnableHamilton(enableHamilton);
+        batch.setThreaded(isThreaded);
+        Clock::time_point begin = Clock::now();
+        std::vector<GameResult> results = batch.run();
+        double elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+
+        SizeType wins = 0, deaths = 0, moves = 0, length = 0;
+        double timeDecide = 0;
+        for (const GameResult &r : results) {
+            wins += r.win;
+            deaths += r.dead;
+            moves += r.moves;
+            length += r.length;
+            timeDecide += r.timeDecide;
+        }
+        cout << "Games: " << results.size() << " (" << wins << " won, " << deaths << " lost, "
+             << results.size() - wins - deaths << " stopped)" << endl;
+        cout << "Average moves: " << (double)moves / results.size() << endl;
+        cout << "Average length: " << (double)length / results.size() << endl;
+        cout << "Total decision time: " << timeDecide << "s" << endl;
+        cout << "Elapsed time: " << elapsed << "s (" << results.size() / elapsed << " games/s)" << endl;
+        return 0;
+    } catch (const std::exception &e) {
+        cout << "ERR: " << e.what() << endl;
+        return -1;
+    }
+}
+
+int GameCtrl::runReplay() {
+    typedef std::chrono::steady_clock Clock;
+    try {
+        Replay replay(replayFile);
+        replay.seek(replayStart);
+        if (visibleGUI) {
+            Console::clear();
+            renderer.invalidate();
+        }
+        Clock::time_point begin = Clock::now();
+        uint64_t frames = 0;
+        Snapshot frame;
+        do {
+            if (visibleGUI) {
+                frame.capture(replay.getMap(), replay.getTick());
+                drawMapContent(frame);
+                if (!unlockMovement) {
+                    util::sleep(moveInterval);
+                }
+            }
+            ++frames;
+        } while (replay.step());
+        double elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+
+        const Map &m = replay.getMap();
+        cout << "Replayed ticks " << replayStart << " to " << replay.getTick()
+             << " of " << replay.getTickCount() << " (seed " << replay.getSeed() << ")" << endl;
+        cout << "Result: " << (m.isAllBody() ? MSG_WIN : "Game not won.") << endl;
+        cout << "Elapsed time: " << elapsed << "s (" << frames / elapsed << " frames/s)" << endl;
+        return 0;
+    } catch (const std::exception &e) {
+        cout << "ERR: " << e.what() << endl;
         return -1;
     }
 }
 
-void GameCtrl::sleepFPS() const {
+void GameCtrl::sleepFPS() {
 	if (visibleGUI) {
-		util::sleep((long)((1.0 / fps) * 1000));
+		waitFor((long)((1.0 / fps) * 1000), runSubThread);
 	}
 }
 
+void GameCtrl::waitFor(const long ms, const std::atomic<bool> &running) {
+    std::unique_lock<std::mutex> lock(mutexExit);
+    exitCond.wait_for(lock, std::chrono::milliseconds(ms), [&running] {
+        return !running;
+    });
+}
+
 void GameCtrl::exitGame(const std::string &msg) {
-    mutexExit.lock();
-    if (runMainThread) {
-        util::sleep(100);
+    bool first;
+    {
+        std::lock_guard<std::mutex> lock(mutexExit);
+        first = runMainThread;
+        runMainThread = false;
         runSubThread = false;
-        util::sleep(100);
+    }
+    exitCond.notify_all();
+    keyReader.wakeup();
+
+    // Only the first call joins, so that a sub-thread calling exitGame()
+    // while the first caller joins it does not wait for the first caller
+    if (first) {
+        joinSubThreads();
         printMsg(msg);
     }
-    mutexExit.unlock();
-    runMainThread = false;
 
-	std::chrono::duration<double> elapsed_seconds = endTime - beginTime;
-	if (runTest) {
-		if (snake.isThreaded()) {
-			cout << "Threaded" << endl;
-		}
-		else {
-			cout << "Sequential" << endl;
-		}
-		if (enableHamilton) {
-			cout << "Elapsed Time for BFS: ";
-			Console::writeWithColor(std::to_string(snake.getTotalTimeBFS()) + "s\n", ConsoleColor(GREEN, BLACK, true, false));
-			cout << "Biggest Time for BFS: ";
-			Console::writeWithColor(std::to_string(snake.getMaxTimeBFS()) + "s\n", ConsoleColor(CYAN, BLACK, true, false));
-			cout << "Elapsed Time for AI:  ";
-			Console::writeWithColor(std::to_string(elapsed_seconds.count()) + "s\n", ConsoleColor(YELLOW, BLACK, true, false));
-			cout << "Max Threads: " << snake.getMaxNumThreadsBFS() << endl;
-		}
-		else {
-			cout << "Elapsed Time for Graph Search: ";
-			Console::writeWithColor(std::to_string(snake.getTotalTimeGraphSearch()) + "s\n", ConsoleColor(GREEN, BLACK, true, false));
-			cout << "Biggest Time for Graph Search: ";
-			Console::writeWithColor(std::to_string(snake.getMaxTimeGraphSearch()) + "s\n", ConsoleColor(CYAN, BLACK, true, false));
-			cout << "Elapsed Time for AI:  ";
-			Console::writeWithColor(std::to_string(elapsed_seconds.count()) + "s\n", ConsoleColor(YELLOW, BLACK, true, false));
-			cout << "Max Threads: " << snake.getMaxNumThreadsGraphSearch() << endl;
+    // Write the rest of the recording, no move can be recorded after this
+    mutexMove.lock();
+    recorder.close();
+    mutexMove.unlock();
+
+	if (runTest || !latencyFile.empty()) {
+		dumpLatency();
+	}
+}
+
+void GameCtrl::writeLatency(std::ostream &out, const bool csv) const {
+	static const double PERCENTILES[] = {0.5, 0.9, 0.99, 0.999};
+	if (csv) {
+		out << "phase,count,min_ns,mean_ns,p50_ns,p90_ns,p99_ns,p999_ns,max_ns,total_ns\n";
+		for (int i = 0; i < Snake::PHASE_COUNT; ++i) {
+			const util::Histogram &h = snake.getLatency((Snake::Phase)i);
+			out << Snake::getPhaseName((Snake::Phase)i) << "," << h.getCount() << "," << h.getMin() << "," << h.getMean();
+			for (const double p : PERCENTILES) {
+				out << "," << h.getPercentile(p);
+			}
+			out << "," << h.getMax() << "," << h.getTotal() << "\n";
 		}
-		cout << endl;
+		return;
 	}
+	string mode = snake.isThreaded() ? "threaded" : (snake.isHybrid() ? "hybrid" : "sequential");
+	out << "{\n  \"mode\": \"" << mode << "\",\n"
+		<< "  \"elapsed_ns\": " << std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - beginTime).count() << ",\n"
+		<< "  \"max_threads_bfs\": " << snake.getMaxNumThreadsBFS() << ",\n"
+		<< "  \"max_threads_graph_search\": " << snake.getMaxNumThreadsGraphSearch() << ",\n"
+		<< "  \"phases\": {\n";
+	for (int i = 0; i < Snake::PHASE_COUNT; ++i) {
+		const util::Histogram &h = snake.getLatency((Snake::Phase)i);
+		out << "    \"" << Snake::getPhaseName((Snake::Phase)i) << "\": {\"count\": " << h.getCount()
+			<< ", \"min_ns\": " << h.getMin() << ", \"mean_ns\": " << h.getMean()
+			<< ", \"p50_ns\": " << h.getPercentile(0.5) << ", \"p90_ns\": " << h.getPercentile(0.9)
+			<< ", \"p99_ns\": " << h.getPercentile(0.99) << ", \"p999_ns\": " << h.getPercentile(0.999)
+			<< ", \"max_ns\": " << h.getMax() << ", \"total_ns\": " << h.getTotal() << "}"
+			<< (i + 1 < Snake::PHASE_COUNT ? ",\n" : "\n");
+	}
+	out << "  }\n}\n";
+}
+
+void GameCtrl::dumpLatency() const {
+	if (latencyFile.empty()) {
+		writeLatency(cout, false);
+		return;
+	}
+	// Appended, so every test of a run is kept
+	std::ofstream out(latencyFile, std::ios::app);
+	if (!out) {
+		// Called on exit, possibly while handling another error
+		cout << "ERR: GameCtrl.dumpLatency(): Fail to open file: " << latencyFile << endl;
+		return;
+	}
+	bool csv = latencyFile.size() >= 4 && latencyFile.compare(latencyFile.size() - 4, 4, ".csv") == 0;
+	writeLatency(out, csv);
 }
 
 void GameCtrl::exitGameErr(const std::string &err) {
@@ -174,6 +318,7 @@ void GameCtrl::printMsg(const std::string &msg) {
 
 void GameCtrl::mainLoop() {
     while (runMainThread) {
+        handleKeys();
         if (!pause) {
             if (enableAI) {
                 snake.decideNext();
@@ -186,8 +331,8 @@ void GameCtrl::mainLoop() {
                 moveSnake();
             }
         }
-		if (!unlockMovement) {
-			util::sleep(moveInterval);
+		if (pause || !unlockMovement) {
+			waitFor(moveInterval, runMainThread);
 		}
     }
 }
@@ -195,12 +340,16 @@ void GameCtrl::mainLoop() {
 void GameCtrl::moveSnake() {
     mutexMove.lock();
     try {
+        Direction moved = snake.isDead() ? NONE : snake.getDirection();
         snake.move();
-        if (recordMovements && snake.getDirection() != NONE) {
-            saveMapContent();
-        }
         if (!map->hasFood()) {
-            map->createRandFood();
+            map->createRandFood(random);
+        }
+        if (recordMovements) {
+            recorder.record(moved, *map, snake);
+        }
+        if (!runTest) {
+            publishFrame();
         }
         mutexMove.unlock();
     } catch (const std::exception) {
@@ -209,39 +358,18 @@ void GameCtrl::moveSnake() {
     }
 }
 
-void GameCtrl::saveMapContent() const {
-    if (!movementFile) {
-        return;
-    }
-    SizeType rows = map->getRowCount(), cols = map->getColCount();
-    for (SizeType i = 0; i < rows; ++i) {
-        for (SizeType j = 0; j < cols; ++j) {
-            switch (map->getPoint(Pos(i, j)).getType()) {
-                case Point::Type::EMPTY:
-                    fwrite("  ", sizeof(char), 2, movementFile); break;
-                case Point::Type::WALL:
-                    fwrite("# ", sizeof(char), 2, movementFile); break;
-                case Point::Type::FOOD:
-                    fwrite("F ", sizeof(char), 2, movementFile); break;
-                case Point::Type::SNAKE_HEAD:
-                    fwrite("H ", sizeof(char), 2, movementFile); break;
-                case Point::Type::SNAKE_BODY:
-                    fwrite("B ", sizeof(char), 2, movementFile); break;
-                case Point::Type::SNAKE_TAIL:
-                    fwrite("T ", sizeof(char), 2, movementFile); break;
-                default:
-                    break;
-            }
-        }
-        fwrite("\n", sizeof(char), 1, movementFile);
-    }
-    fwrite("\n", sizeof(char), 1, movementFile);
+void GameCtrl::publishFrame() {
+    frames.back().capture(*map, ++frameCnt);
+    frames.publish();
 }
 
 void GameCtrl::init() {
+    runMainThread = true;
 	if (visibleGUI) {
 		Console::clear();
+		renderer.invalidate();
 	}
+    random.seed(seed);
     initMap();
     if (!runTest) {
         initSnake();
@@ -249,6 +377,7 @@ void GameCtrl::init() {
             initFiles();
         }
     }
+    publishFrame();
     startSubThreads();
 }
 
@@ -258,6 +387,7 @@ void GameCtrl::initMap() {
             + util::toString(mapRowCnt) + "*" + util::toString(mapColCnt) + ".";
         throw std::range_error(msg.c_str());
     }
+    delete map;  // Of the last game when restarted
     map = new Map(mapRowCnt, mapColCnt);
     if (!map) {
         exitGameErr(MSG_BAD_ALLOC);
@@ -267,7 +397,9 @@ void GameCtrl::initMap() {
 }
 
 void GameCtrl::initSnake() {
+    snake = Snake();
     snake.setMap(map);
+    snake.setSeed(random.next());
     snake.addBody(Pos(1, 3));
     snake.addBody(Pos(1, 2));
     snake.addBody(Pos(1, 1));
@@ -280,34 +412,38 @@ void GameCtrl::initSnake() {
 }
 
 void GameCtrl::initFiles() {
-#ifdef defined(OSWIN)
-    errno_t error = fopen_s(&movementFile, MAP_INFO_FILENAME.c_str(), "w");
-#endif
-    if (!movementFile) {
-        throw std::runtime_error("GameCtrl.initFiles(): Fail to open file: " + MAP_INFO_FILENAME);
-    } else {
-        // Write content description to the file
-        string str = "Content description:\n";
-        str += "#: wall\nH: snake head\nB: snake body\nT: snake tail\nF: food\n\n";
-        str += "Movements:\n\n";
-        fwrite(str.c_str(), sizeof(char), str.length(), movementFile);
-    }
+    recorder.open(MAP_INFO_FILENAME, *map, snake, seed);
 }
 
 void GameCtrl::startSubThreads() {
     runSubThread = true;
+    keys.setCapacity(64);
 	if (visibleGUI) {
 		drawThread = std::thread(&GameCtrl::draw, this);
-		drawThread.detach();
 	}
     keyboardThread = std::thread(&GameCtrl::keyboard, this);
-    keyboardThread.detach();
+}
+
+void GameCtrl::joinSubThreads() {
+    std::lock_guard<std::mutex> lock(mutexJoin);
+    std::thread::id self = std::this_thread::get_id();
+    if (drawThread.joinable() && drawThread.get_id() != self) {
+        drawThread.join();
+    }
+    if (keyboardThread.joinable() && keyboardThread.get_id() != self) {
+        keyboardThread.join();
+    }
 }
 
 void GameCtrl::draw() {
     try {
         while (runSubThread) {
-            drawMapContent();
+            if (runTest) {
+                publishFrame();
+            }
+            if (frames.update()) {
+                drawMapContent(frames.front());
+            }
             sleepFPS();
         }
     } catch (const std::exception &e) {
@@ -315,95 +451,103 @@ void GameCtrl::draw() {
     }
 }
 
-void GameCtrl::drawMapContent() const {
-    Console::setCursor();
-    SizeType row = map->getRowCount(), col = map->getColCount();
+void GameCtrl::drawMapContent(const Snapshot &frame) {
+    SizeType row = frame.getRowCount(), col = frame.getColCount();
+    renderer.resize(row, col);
     for (SizeType i = 0; i < row; ++i) {
         for (SizeType j = 0; j < col; ++j) {
-            const Point &point = map->getPoint(Pos(i, j));
-            switch (point.getType()) {
+            SizeType idx = i * col + j;
+            switch (frame.getTypeAt(idx)) {
                 case Point::Type::EMPTY:
-                    Console::writeWithColor("  ", ConsoleColor(BLACK, BLACK));
+                    renderer.setCell(i, j, "  ", ConsoleColor(BLACK, BLACK));
                     break;
                 case Point::Type::WALL:
-                    Console::writeWithColor("  ", ConsoleColor(WHITE, WHITE, true, true));
+                    renderer.setCell(i, j, "  ", ConsoleColor(WHITE, WHITE, true, true));
                     break;
                 case Point::Type::FOOD:
-                    Console::writeWithColor("  ", ConsoleColor(YELLOW, YELLOW, true, true));
+                    renderer.setCell(i, j, "  ", ConsoleColor(YELLOW, YELLOW, true, true));
                     break;
                 case Point::Type::SNAKE_HEAD:
-                    Console::writeWithColor("  ", ConsoleColor(RED, RED, true, true));
+                    renderer.setCell(i, j, "  ", ConsoleColor(RED, RED, true, true));
                     break;
                 case Point::Type::SNAKE_BODY:
-                    Console::writeWithColor("  ", ConsoleColor(GREEN, GREEN, true, true));
+                    renderer.setCell(i, j, "  ", ConsoleColor(GREEN, GREEN, true, true));
                     break;
                 case Point::Type::SNAKE_TAIL:
-                    Console::writeWithColor("  ", ConsoleColor(BLUE, BLUE, true, true));
+                    renderer.setCell(i, j, "  ", ConsoleColor(BLUE, BLUE, true, true));
                     break;
                 case Point::Type::TEST_VISIT:
-                    drawTestPoint(point, ConsoleColor(BLUE, GREEN, true, true));
+                    drawTestPoint(Pos(i, j), frame.getDistAt(idx), ConsoleColor(BLUE, GREEN, true, true));
                     break;
                 case Point::Type::TEST_PATH:
-                    drawTestPoint(point, ConsoleColor(BLUE, RED, true, true));
+                    drawTestPoint(Pos(i, j), frame.getDistAt(idx), ConsoleColor(BLUE, RED, true, true));
                     break;
                 default:
                     break;
             }
         }
-        Console::write("\n");
     }
+    renderer.present();
 }
 
-void GameCtrl::drawTestPoint(const Point &p, const ConsoleColor &consoleColor) const {
+void GameCtrl::drawTestPoint(const Pos &pos, const Point::ValueType dist, const ConsoleColor &consoleColor) {
     string pointStr = "";
-    if (p.getDist() == Point::MAX_VALUE) {
+    if (dist == Point::MAX_VALUE) {
         pointStr = "In";
-    } else if (p.getDist() == Point::EMPTY_DIST) {
+    } else if (dist == Point::EMPTY_DIST) {
         pointStr = "  ";
     } else {
-        Point::ValueType dist = p.getDist();
-        pointStr = util::toString(p.getDist());
+        pointStr = util::toString(dist);
         if (dist / 10 == 0) {
             pointStr.insert(0, " ");
         } 
     }
-    Console::writeWithColor(pointStr, consoleColor);
+    renderer.setCell(pos.getX(), pos.getY(), pointStr, consoleColor);
 }
 
 void GameCtrl::keyboard() {
     try {
-        while (runSubThread) {
-            if (Console::kbhit()) {
-                switch (Console::getch()) {
-                    case 'w':
-                        keyboardMove(snake, Direction::UP);
-                        break;
-                    case 'a':
-                        keyboardMove(snake, Direction::LEFT);
-                        break;
-                    case 's':
-                        keyboardMove(snake, Direction::DOWN);
-                        break;
-                    case 'd':
-                        keyboardMove(snake, Direction::RIGHT);
-                        break;
-                    case ' ':
-                        pause = !pause;  // Pause or resume game
-                        break;
-                    case 27:  // Esc
-                        exitGame(MSG_ESC);
-                        break;
-                    default:
-                        break;
-                }
+        keyReader.open();
+        char key;
+        while (runSubThread && keyReader.read(key)) {
+            if (key == 27) {  // Esc
+                exitGame(MSG_ESC);
+            } else {
+                keys.push(&key, 1);  // Dropped if the game loop falls far behind
             }
-            sleepFPS();
         }
+        keyReader.close();
     } catch (const std::exception &e) {
+        keyReader.close();
         exitGameErr(e.what());
     }
 }
 
+void GameCtrl::handleKeys() {
+    char key;
+    while (keys.pop(&key, 1)) {
+        switch (key) {
+            case 'w':
+                keyboardMove(snake, Direction::UP);
+                break;
+            case 'a':
+                keyboardMove(snake, Direction::LEFT);
+                break;
+            case 's':
+                keyboardMove(snake, Direction::DOWN);
+                break;
+            case 'd':
+                keyboardMove(snake, Direction::RIGHT);
+                break;
+            case ' ':
+                pause = !pause;  // Pause or resume game
+                break;
+            default:
+                break;
+        }
+    }
+}
+
 void GameCtrl::keyboardMove(Snake &s, const Direction d) {
     if (pause) {
         s.setDirection(d);
@@ -425,44 +569,56 @@ void GameCtrl::test() {
 	testSequentialPathSearch();
 	testThreadedPathSearch();
 	testThreadedPathSearch();
+	testHybridPathSearch();
+	testHybridPathSearch();
 }
 
 
 void GameCtrl::testSequentialPathSearch() {
-	if (mapRowCnt < 10 || mapColCnt < 10) {
-		throw std::range_error("GameCtrl.testSequentialPathSearch() requires map size 10x10");
-	}
-	if (mapRowCnt == 20 && mapColCnt == 20) {
-		map->createFood(Pos(18, 18));
-	}
-	else if (mapRowCnt == 10 && mapColCnt == 10) {
-		map->createFood(Pos(8, 8));
-	}
-	else if (mapRowCnt == 100 && mapColCnt == 100) {
-		map->createFood(Pos(98, 98));
-	}
-	else if (mapRowCnt == 50 && mapColCnt == 50) {
-		map->createFood(Pos(48, 48));
-	}
-	else if (mapRowCnt == 30 && mapColCnt == 30) {
-		map->createFood(Pos(28, 28));
-	}
-	snake = Snake();
-	snake.setMap(map);
-	snake.addBody(Pos(1, 3));
-	snake.addBody(Pos(1, 2));
-	snake.addBody(Pos(1, 1));
+	initPathSearchTest("testSequentialPathSearch()");
 	if (enableHamilton)
 		snake.enableHamilton();
-	beginTime = std::chrono::system_clock::now();
+	beginTime = std::chrono::steady_clock::now();
 	snake.testPathSearch();
-	endTime = std::chrono::system_clock::now();
+	endTime = std::chrono::steady_clock::now();
 	exitGame("testSequentialPathSearch() finished.");
 }
 
 void GameCtrl::testThreadedPathSearch() {
+	initPathSearchTest("testThreadedPathSearch()");
+	snake.enableThreaded();
+	if (enableHamilton)
+		snake.enableHamilton();
+	beginTime = std::chrono::steady_clock::now();
+	snake.testPathSearch();
+	endTime = std::chrono::steady_clock::now();
+	exitGame("testThreadedPathSearch() finished.");
+}
+
+void GameCtrl::testHybridPathSearch() {
+	initPathSearchTest("testHybridPathSearch()");
+	snake.enableHybrid();
+	if (enableHamilton)
+		snake.enableHamilton();
+	beginTime = std::chrono::steady_clock::now();
+	snake.testPathSearch();
+	endTime = std::chrono::steady_clock::now();
+	exitGame("testHybridPathSearch() finished.");
+}
+
+void GameCtrl::initPathSearchTest(const std::string &testName) {
 	if (mapRowCnt < 10 || mapColCnt < 10) {
-		throw std::range_error("GameCtrl.testThreadedPathSearch() requires map size 10x10");
+		throw std::range_error("GameCtrl." + testName + " requires map size 10x10");
+	}
+	// Remove the snake of the last test, so every test starts on the same map
+	for (SizeType i = 1; i < mapRowCnt - 1; ++i) {
+		for (SizeType j = 1; j < mapColCnt - 1; ++j) {
+			Point::Type type = map->getPoint(Pos(i, j)).getType();
+			if (type == Point::Type::SNAKE_BODY || type == Point::Type::SNAKE_HEAD
+				|| type == Point::Type::SNAKE_TAIL) {
+				map->setPointType(Pos(i, j), Point::Type::EMPTY);
+			}
+		}
 	}
 	if (mapRowCnt == 20 && mapColCnt == 20) {
 		map->createFood(Pos(18, 18));
@@ -481,23 +637,16 @@ void GameCtrl::testThreadedPathSearch() {
 	}
 	snake = Snake();
 	snake.setMap(map);
-	snake.enableThreaded();
 	snake.addBody(Pos(1, 3));
 	snake.addBody(Pos(1, 2));
 	snake.addBody(Pos(1, 1));
-	if (enableHamilton)
-		snake.enableHamilton();
-	beginTime = std::chrono::system_clock::now();
-	snake.testPathSearch();
-	endTime = std::chrono::system_clock::now();
-	exitGame("testThreadedPathSearch() finished.");
 }
 
 
 void GameCtrl::testFood() {
     SizeType cnt = 0;
     while (runMainThread && cnt++ < map->getSize()) {
-        map->createRandFood();
+        map->createRandFood(random);
         sleepFPS();
     }
     exitGame("testFood() finished.");
@@ -508,14 +657,14 @@ void GameCtrl::testSearch() {
         throw std::range_error("GameCtrl.testSearch(): Require map size 20*20.");
     }
 
-    list<Direction> path;
+    PathBuffer path;
     snake.setMap(map);
 
     // Add walls for testing
     for (int i = 4; i < 16; ++i) {
-        map->getPoint(Pos(i, 9)).setType(Point::Type::WALL);   // vertical
-        map->getPoint(Pos(4, i)).setType(Point::Type::WALL);   // horizontal #1
-        map->getPoint(Pos(15, i)).setType(Point::Type::WALL);  // horizontal #2
+        map->setPointType(Pos(i, 9), Point::Type::WALL);   // vertical
+        map->setPointType(Pos(4, i), Point::Type::WALL);   // horizontal #1
+        map->setPointType(Pos(15, i), Point::Type::WALL);  // horizontal #2
     }
    
     Pos from(6, 7), to(14, 13);
@@ -17,9 +17,13 @@ int main() {
     game->setMoveInterval(30);
 
     // Set whether to record the snake's movements to file. Default is true.
-    // The movements will be written to a file named "movements.txt".
+    // The movements will be written to a binary file named "movements.rec",
+    // which can be read back with the Replay class.
     game->setRecordMovements(false);
 
+    // Set a recording to play instead of a game, from a given tick.
+    // game->setRunReplay("movements.rec", 0);
+
     // Set whether to run the test program. Default is false.
     // You can select different testing methods by modifying GameCtrl::test().
     game->setRunTest(true);
@@ -31,6 +35,14 @@ int main() {
 
 	game->setUnlockMovement(true);
 
+    // Set the file the decision latencies are written to at exit, as CSV if
+    // the name ends with ".csv" and as JSON otherwise. Default is empty.
+    // game->setLatencyFile("latency.json");
+
+    // Set the seed of the random numbers. Default is the current time.
+    // A fixed seed plays the same game every run.
+    // game->setSeed(2017);
+
     // Set map's size(including boundaries). Default is 10*10. Minimum is 5*5.
     game->setMapRow(10);
     game->setMapCol(10);
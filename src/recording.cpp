@@ -0,0 +1,511 @@
+#include "recording.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+using std::string;
+using std::vector;
+
+namespace recording {
+
+const char MAGIC[4] = {'S', 'N', 'K', 'R'};
+const char INDEX_MAGIC[4] = {'S', 'N', 'K', 'I'};
+
+}
+
+using namespace recording;
+
+const Recorder::SizeType Recorder::BLOCK_SIZE = 1 << 16;
+
+Recorder::Recorder() : stop(false) {}
+
+Recorder::~Recorder() {
+    close();
+}
+
+void Recorder::setKeyframeInterval(const SizeType n) {
+    keyframeInterval = n ? n : 1;
+}
+
+void Recorder::setOverflow(const Overflow overflow_) {
+    overflow = overflow_;
+}
+
+void Recorder::setQueueCapacity(const SizeType bytes) {
+    queueCapacity = bytes;
+}
+
+void Recorder::setFlushInterval(const long ms) {
+    flushInterval = ms;
+}
+
+uint64_t Recorder::getDroppedCount() const {
+    return droppedCnt;
+}
+
+void Recorder::open(const string &filename, const Map &map, const Snake &snake, const uint64_t seed) {
+    close();
+    file = fopen(filename.c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("Recorder.open(): Fail to open file: " + filename);
+    }
+    tick = 0;
+    lastFood = 0;
+    resync = false;
+    droppedCnt = 0;
+    backlog.clear();
+    backlogBeg = 0;
+    keyframeTicks.clear();
+    keyframeOffsets.clear();
+
+    encoded.clear();
+    for (const char c : MAGIC) {
+        encoded.push_back((uint8_t)c);
+    }
+    encoded.push_back(VERSION);
+    SizeType rows = map.getRowCount(), cols = map.getColCount();
+    encodeVarint(rows);
+    encodeVarint(cols);
+    encodeFixed(seed);
+    encodeVarint(keyframeInterval);
+    vector<SizeType> walls;
+    for (SizeType i = 1; i < rows - 1; ++i) {
+        for (SizeType j = 1; j < cols - 1; ++j) {
+            if (map.getPointAt(i * cols + j).getType() == Point::Type::WALL) {
+                walls.push_back(i * cols + j);
+            }
+        }
+    }
+    encodeVarint(walls.size());
+    for (const SizeType idx : walls) {
+        encodeVarint(idx);
+    }
+    const util::RingBuffer<uint32_t> &bodies = snake.getBodies();
+    encodeVarint(bodies.size());
+    for (SizeType i = 0; i < bodies.size(); ++i) {
+        encodeVarint(bodies[i]);
+    }
+    fwrite(encoded.data(), 1, encoded.size(), file);
+    written = encoded.size();
+
+    // A tick with a keyframe must fit in the queue, or DROP would drop it forever.
+    // A varint of an index takes at most 5 bytes.
+    SizeType maxTick = 16 + 5 * (map.getSize() + 2);
+    queue.setCapacity(std::max(queueCapacity, 2 * maxTick));
+    encoded.reserve(maxTick);
+    stop = false;
+    writer = std::thread(&Recorder::write, this);
+}
+
+void Recorder::record(const Direction moved, const Map &map, const Snake &snake) {
+    if (!file) {
+        return;
+    }
+    SizeType food = map.hasFood() ? map.getIndex(map.getFood()) : 0;
+    bool newFood = food && food != lastFood;
+    if (moved == NONE && !newFood) {
+        return;
+    }
+    lastFood = food;
+    ++tick;
+    encoded.clear();
+    SizeType keyframePos = SIZE_MAX;
+    if (resync) {
+        // The state before this tick is unknown to the reader, so a
+        // keyframe takes the place of the tick record
+        keyframePos = 0;
+        encodeKeyframe(map, snake);
+    } else {
+        encoded.push_back((uint8_t)moved | (newFood ? FOOD_FLAG : 0));
+        if (newFood) {
+            encodeVarint(food);
+        }
+        if (tick % keyframeInterval == 0) {
+            keyframePos = encoded.size();
+            encodeKeyframe(map, snake);
+        }
+    }
+    resync = !push();
+    if (resync) {
+        ++droppedCnt;
+        return;
+    }
+    if (keyframePos != SIZE_MAX) {
+        keyframeTicks.push_back(tick);
+        keyframeOffsets.push_back(written + keyframePos);
+    }
+    written += encoded.size();
+}
+
+void Recorder::close() {
+    if (!file) {
+        return;
+    }
+    while (backlogBeg < backlog.size()) {
+        drainBacklog();
+        wakeup.notify_one();
+        std::this_thread::yield();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wakeup.notify_one();
+    writer.join();
+    writeIndex();
+    fclose(file);
+    file = nullptr;
+}
+
+bool Recorder::isOpen() const {
+    return file != nullptr;
+}
+
+void Recorder::encodeVarint(uint64_t value) {
+    while (value >= 0x80) {
+        encoded.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    encoded.push_back((uint8_t)value);
+}
+
+void Recorder::encodeFixed(const uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        encoded.push_back((uint8_t)(value >> (8 * i)));
+    }
+}
+
+void Recorder::encodeKeyframe(const Map &map, const Snake &snake) {
+    encoded.push_back(KEYFRAME);
+    encodeVarint(tick);
+    const util::RingBuffer<uint32_t> &bodies = snake.getBodies();
+    encodeVarint(bodies.size());
+    for (SizeType i = 0; i < bodies.size(); ++i) {
+        encodeVarint(bodies[i]);
+    }
+    encodeVarint(map.hasFood() ? map.getIndex(map.getFood()) + 1 : 0);
+}
+
+bool Recorder::push() {
+    bool pushed = true;
+    switch (overflow) {
+        case Overflow::BLOCK: {
+            SizeType done = 0;
+            while ((done += queue.push(encoded.data() + done, encoded.size() - done)) < encoded.size()) {
+                wakeup.notify_one();
+                std::this_thread::yield();
+            }
+            break;
+        }
+        case Overflow::DROP:
+            pushed = queue.pushAll(encoded.data(), encoded.size());
+            break;
+        case Overflow::GROW: {
+            drainBacklog();
+            SizeType done = 0;
+            if (backlogBeg == backlog.size()) {
+                done = queue.push(encoded.data(), encoded.size());
+            }
+            backlog.insert(backlog.end(), encoded.begin() + done, encoded.end());
+            break;
+        }
+    }
+    // Wake the writer early when the queue fills up
+    if (queue.size() > queue.capacity() / 2) {
+        wakeup.notify_one();
+    }
+    return pushed;
+}
+
+void Recorder::writeIndex() {
+    SizeType entryCnt = (SizeType)(tick / keyframeInterval + 1);
+    encoded.clear();
+    SizeType k = 0;
+    uint64_t offset = 0;
+    for (SizeType entry = 0; entry < entryCnt; ++entry) {
+        uint64_t entryTick = (uint64_t)entry * keyframeInterval;
+        while (k < keyframeTicks.size() && keyframeTicks[k] <= entryTick) {
+            offset = keyframeOffsets[k++];
+        }
+        encodeFixed(offset);
+    }
+    encodeFixed(written);
+    encodeFixed(tick);
+    encodeFixed(entryCnt);
+    for (const char c : INDEX_MAGIC) {
+        encoded.push_back((uint8_t)c);
+    }
+    fwrite(encoded.data(), 1, encoded.size(), file);
+}
+
+void Recorder::drainBacklog() {
+    backlogBeg += queue.push(backlog.data() + backlogBeg, backlog.size() - backlogBeg);
+    if (backlogBeg == backlog.size()) {
+        backlog.clear();
+        backlogBeg = 0;
+    }
+}
+
+void Recorder::write() {
+    typedef std::chrono::steady_clock Clock;
+    const Clock::duration interval = std::chrono::milliseconds(flushInterval);
+    vector<uint8_t> block(BLOCK_SIZE);
+    SizeType used = 0;
+    Clock::time_point oldest;
+    while (true) {
+        // Read the flag first: everything pushed before stop was set is popped below
+        bool stopping = stop;
+        SizeType n = queue.pop(block.data() + used, block.size() - used);
+        Clock::time_point now = Clock::now();
+        if (n && !used) {
+            oldest = now;
+        }
+        used += n;
+        if (used && (used == block.size() || now - oldest >= interval || (stopping && !n))) {
+            fwrite(block.data(), 1, used, file);
+            fflush(file);
+            used = 0;
+        }
+        if (n) {
+            continue;
+        }
+        if (stopping) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!stop) {
+            wakeup.wait_for(lock, used ? oldest + interval - now : interval);
+        }
+    }
+}
+
+Replay::Replay(const string &filename) : file(new util::MappedFile(filename)) {
+    data = file->data();
+    recordsEnd = file->size();
+    if (recordsEnd < sizeof(MAGIC) + 1 || memcmp(data, MAGIC, sizeof(MAGIC)) != 0
+        || data[sizeof(MAGIC)] != VERSION) {
+        throw std::runtime_error("Replay.Replay(): Not a recording: " + filename);
+    }
+    bool indexed = readIndex();
+
+    SizeType off = sizeof(MAGIC) + 1;
+    rowCnt = (SizeType)readVarint(off);
+    colCnt = (SizeType)readVarint(off);
+    if (off + 8 > recordsEnd) {
+        throw std::runtime_error("Replay.Replay(): Truncated recording: " + filename);
+    }
+    seed = readFixed(off);
+    off += 8;
+    keyframeInterval = (SizeType)readVarint(off);
+    walls.resize((SizeType)readVarint(off));
+    for (SizeType &idx : walls) {
+        idx = (SizeType)readVarint(off);
+    }
+    initBodies.resize((SizeType)readVarint(off));
+    for (SizeType &idx : initBodies) {
+        idx = (SizeType)readVarint(off);
+    }
+    recordsBeg = off;
+
+    if (!indexed) {  // Count the ticks
+        while (off < recordsEnd) {
+            if (data[off] == KEYFRAME) {  // Ticks were dropped
+                SizeType kf = off + 1;
+                tickCnt = readVarint(kf);
+                skipKeyframe(off, tickCnt);
+                continue;
+            }
+            if (data[off++] & FOOD_FLAG) {
+                readVarint(off);
+            }
+            skipKeyframe(off, ++tickCnt);
+        }
+    }
+    seek(0);
+}
+
+Replay::~Replay() {}
+
+Replay::SizeType Replay::getRowCount() const {
+    return rowCnt;
+}
+
+Replay::SizeType Replay::getColCount() const {
+    return colCnt;
+}
+
+uint64_t Replay::getSeed() const {
+    return seed;
+}
+
+uint64_t Replay::getTickCount() const {
+    return tickCnt;
+}
+
+uint64_t Replay::getTick() const {
+    return tick;
+}
+
+const Map& Replay::getMap() const {
+    return *map;
+}
+
+void Replay::seek(const uint64_t t) {
+    if (!map || t < tick || t - tick >= keyframeInterval) {
+        SizeType keyframe;
+        if (indexCnt) {
+            SizeType entry = (SizeType)std::min(t / keyframeInterval, (uint64_t)indexCnt - 1);
+            keyframe = (SizeType)readFixed(indexBeg + 8 * entry);
+        } else {
+            keyframe = scanKeyframe(t);
+        }
+        if (keyframe) {
+            readKeyframe(keyframe);
+            offset = keyframe;
+        } else {
+            restore(initBodies, 0);
+            tick = 0;
+            offset = recordsBeg;
+        }
+    }
+    while (peekTick() <= t) {
+        step();
+    }
+}
+
+bool Replay::step() {
+    if (offset >= recordsEnd) {
+        return false;
+    }
+    if (data[offset] == KEYFRAME) {  // Jump over the dropped ticks
+        readKeyframe(offset);
+        return true;
+    }
+    uint8_t rec = data[offset++];
+    Direction d = (Direction)(rec & DIREC_MASK);
+    if (d != NONE) {
+        snake.setDirection(d);
+        snake.move();
+    }
+    if (rec & FOOD_FLAG) {
+        map->createFood(map->getPos((SizeType)readVarint(offset)));
+    }
+    skipKeyframe(offset, ++tick);
+    return true;
+}
+
+uint64_t Replay::peekTick() const {
+    if (offset >= recordsEnd) {
+        return UINT64_MAX;
+    }
+    if (data[offset] == KEYFRAME) {
+        SizeType kf = offset + 1;
+        return readVarint(kf);
+    }
+    return tick + 1;
+}
+
+void Replay::readKeyframe(SizeType &off) {
+    ++off;
+    tick = readVarint(off);
+    vector<SizeType> bodyIdx((SizeType)readVarint(off));
+    for (SizeType &idx : bodyIdx) {
+        idx = (SizeType)readVarint(off);
+    }
+    SizeType food = (SizeType)readVarint(off);
+    restore(bodyIdx, food ? food - 1 : 0);
+}
+
+Replay::SizeType Replay::scanKeyframe(const uint64_t t) const {
+    SizeType off = recordsBeg, keyframe = 0;
+    uint64_t cur = 0;
+    while (off < recordsEnd) {
+        if (data[off] == KEYFRAME) {
+            SizeType kf = off + 1;
+            uint64_t kfTick = readVarint(kf);
+            if (kfTick > t) {
+                break;
+            }
+            keyframe = off;
+            cur = kfTick;
+            skipKeyframe(off, cur);
+            continue;
+        }
+        if (cur + 1 > t) {
+            break;
+        }
+        if (data[off++] & FOOD_FLAG) {
+            readVarint(off);
+        }
+        ++cur;
+    }
+    return keyframe;
+}
+
+bool Replay::readIndex() {
+    const SizeType TRAILER = 3 * 8 + sizeof(INDEX_MAGIC);
+    SizeType size = recordsEnd;
+    if (size < TRAILER || memcmp(data + size - sizeof(INDEX_MAGIC), INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) {
+        return false;
+    }
+    uint64_t end = readFixed(size - TRAILER);
+    uint64_t cnt = readFixed(size - TRAILER + 16);
+    if (end > size || cnt == 0 || end + 8 * cnt + TRAILER != size) {
+        return false;
+    }
+    tickCnt = readFixed(size - TRAILER + 8);
+    recordsEnd = (SizeType)end;
+    indexBeg = (SizeType)end;
+    indexCnt = (SizeType)cnt;
+    return true;
+}
+
+uint64_t Replay::readFixed(const SizeType off) const {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= (uint64_t)data[off + i] << (8 * i);
+    }
+    return value;
+}
+
+uint64_t Replay::readVarint(SizeType &off) const {
+    uint64_t value = 0;
+    for (int shift = 0; off < recordsEnd && shift < 64; shift += 7) {
+        uint8_t b = data[off++];
+        value |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            return value;
+        }
+    }
+    throw std::runtime_error("Replay.readVarint(): Truncated recording.");
+}
+
+void Replay::restore(const vector<SizeType> &bodyIdx, const SizeType foodIdx) {
+    map.reset(new Map(rowCnt, colCnt));
+    for (const SizeType idx : walls) {
+        map->setPointType(map->getPos(idx), Point::Type::WALL);
+    }
+    snake = Snake();
+    snake.setMap(map.get());
+    for (const SizeType idx : bodyIdx) {
+        snake.addBody(map->getPos(idx));
+    }
+    if (foodIdx) {
+        map->createFood(map->getPos(foodIdx));
+    }
+}
+
+void Replay::skipKeyframe(SizeType &off, const uint64_t t) const {
+    if (off < recordsEnd && data[off] == KEYFRAME) {
+        SizeType next = off + 1;
+        if (readVarint(next) != t) {
+            return;  // Stands for dropped ticks, so it is read as a record
+        }
+        for (uint64_t n = readVarint(next); n > 0; --n) {
+            readVarint(next);
+        }
+        readVarint(next);
+        off = next;
+    }
+}
@@ -0,0 +1,92 @@
+#include "util/histogram.h"
+#include "util/util.h"
+#include <algorithm>
+#include <cmath>
+
+namespace util {
+
+// Values below SUB_BUCKET_CNT have a bucket each, then every power of two
+// up to 2^63 adds SUB_BUCKET_CNT buckets
+static const int BUCKET_CNT = (64 - Histogram::SUB_BITS + 1) * Histogram::SUB_BUCKET_CNT;
+
+Histogram::Histogram() : buckets(BUCKET_CNT, 0) {}
+
+Histogram::~Histogram() {}
+
+int Histogram::getBucket(const uint64_t value) {
+    if (value < SUB_BUCKET_CNT) {
+        return (int)value;
+    }
+    int shift = highestBit(value) - SUB_BITS;
+    return (shift + 1) * SUB_BUCKET_CNT + (int)((value >> shift) & (SUB_BUCKET_CNT - 1));
+}
+
+uint64_t Histogram::getBucketMax(const int bucket) {
+    if (bucket < SUB_BUCKET_CNT) {
+        return (uint64_t)bucket;
+    }
+    int shift = bucket / SUB_BUCKET_CNT - 1;
+    uint64_t lower = (uint64_t)(SUB_BUCKET_CNT + bucket % SUB_BUCKET_CNT) << shift;
+    return lower + (((uint64_t)1 << shift) - 1);
+}
+
+void Histogram::record(const uint64_t value) {
+    ++buckets[getBucket(value)];
+    ++count;
+    total += value;
+    min = std::min(min, value);
+    max = std::max(max, value);
+}
+
+void Histogram::merge(const Histogram &other) {
+    for (int i = 0; i < BUCKET_CNT; ++i) {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    total += other.total;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+void Histogram::clear() {
+    std::fill(buckets.begin(), buckets.end(), 0);
+    count = total = max = 0;
+    min = UINT64_MAX;
+}
+
+uint64_t Histogram::getCount() const {
+    return count;
+}
+
+uint64_t Histogram::getTotal() const {
+    return total;
+}
+
+uint64_t Histogram::getMin() const {
+    return count ? min : 0;
+}
+
+uint64_t Histogram::getMax() const {
+    return max;
+}
+
+double Histogram::getMean() const {
+    return count ? (double)total / count : 0;
+}
+
+uint64_t Histogram::getPercentile(const double p) const {
+    if (!count) {
+        return 0;
+    }
+    uint64_t rank = std::max((uint64_t)std::ceil(p * count), (uint64_t)1);
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_CNT; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::max(std::min(getBucketMax(i), max), getMin());
+        }
+    }
+    return max;
+}
+
+}
@@ -0,0 +1,113 @@
+#include "util/keyreader.h"
+#include "util/util.h"
+
+#ifdef OS_UNIX
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#elif defined(OS_WIN)
+#include <conio.h>
+#endif
+
+KeyReader::KeyReader() : woken(false) {
+#ifdef OS_UNIX
+    if (pipe(pipeFds) == 0) {
+        // Wakeups never block, extra ones are dropped when the pipe is full
+        fcntl(pipeFds[0], F_SETFL, fcntl(pipeFds[0], F_GETFL, 0) | O_NONBLOCK);
+        fcntl(pipeFds[1], F_SETFL, fcntl(pipeFds[1], F_GETFL, 0) | O_NONBLOCK);
+    } else {
+        pipeFds[0] = pipeFds[1] = -1;
+    }
+#endif
+}
+
+KeyReader::~KeyReader() {
+    close();
+#ifdef OS_UNIX
+    for (int fd : pipeFds) {
+        if (fd != -1) {
+            ::close(fd);
+        }
+    }
+#endif
+}
+
+void KeyReader::open() {
+    woken = false;
+#ifdef OS_UNIX
+    char buf[64];
+    while (pipeFds[0] != -1 && ::read(pipeFds[0], buf, sizeof(buf)) > 0) {}
+    if (!rawMode && isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &oldAttr) == 0) {
+        struct termios attr = oldAttr;
+        attr.c_lflag &= ~(ICANON | ECHO);
+        attr.c_cc[VMIN] = 1;
+        attr.c_cc[VTIME] = 0;
+        rawMode = tcsetattr(STDIN_FILENO, TCSANOW, &attr) == 0;
+    }
+#endif
+}
+
+void KeyReader::close() {
+#ifdef OS_UNIX
+    if (rawMode) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &oldAttr);
+        rawMode = false;
+    }
+#endif
+}
+
+bool KeyReader::read(char &key) {
+#ifdef OS_UNIX
+    struct pollfd fds[2];
+    fds[0].fd = STDIN_FILENO;
+    fds[0].events = POLLIN;
+    fds[1].fd = pipeFds[0];
+    fds[1].events = POLLIN;
+    while (!woken) {
+        fds[0].revents = fds[1].revents = 0;
+        if (poll(fds, pipeFds[0] != -1 ? 2 : 1, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (fds[1].revents) {
+            return false;  // Woken up
+        }
+        if (fds[0].revents) {
+            ssize_t n = ::read(STDIN_FILENO, &key, 1);
+            if (n == 1) {
+                return true;
+            } else if (n == 0 || errno != EINTR) {
+                return false;  // End of input
+            }
+        }
+    }
+    return false;
+#elif defined(OS_WIN)
+    // The console input handle cannot be waited on together with a wakeup,
+    // so check both at a short interval instead
+    while (!woken) {
+        if (_kbhit()) {
+            key = (char)_getch();
+            return true;
+        }
+        util::sleep(10);
+    }
+    return false;
+#else
+    // Other platforms
+    return false;
+#endif
+}
+
+void KeyReader::wakeup() {
+    woken = true;
+#ifdef OS_UNIX
+    if (pipeFds[1] != -1) {
+        char c = 0;
+        if (::write(pipeFds[1], &c, 1) < 0) {}
+    }
+#endif
+}
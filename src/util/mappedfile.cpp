@@ -0,0 +1,99 @@
+#include "util/mappedfile.h"
+#include <stdexcept>
+
+#if defined(WIN32) || defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace util {
+
+#if defined(WIN32) || defined(_WIN32)
+
+MappedFile::MappedFile(const std::string &filename) {
+    fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        fileHandle = nullptr;
+        throw std::runtime_error("MappedFile.MappedFile(): Fail to open file: " + filename);
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(fileHandle, &fileSize);
+    len = (SizeType)fileSize.QuadPart;
+    if (len == 0) {
+        return;
+    }
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle) {
+        ptr = (const uint8_t *)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    }
+    if (!ptr) {
+        release();
+        throw std::runtime_error("MappedFile.MappedFile(): Fail to map file: " + filename);
+    }
+}
+
+MappedFile::~MappedFile() {
+    release();
+}
+
+void MappedFile::release() {
+    if (ptr) {
+        UnmapViewOfFile(ptr);
+        ptr = nullptr;
+    }
+    if (mappingHandle) {
+        CloseHandle(mappingHandle);
+        mappingHandle = nullptr;
+    }
+    if (fileHandle) {
+        CloseHandle(fileHandle);
+        fileHandle = nullptr;
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("MappedFile.MappedFile(): Fail to open file: " + filename);
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        len = (SizeType)st.st_size;
+        void *p = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        ptr = (p == MAP_FAILED ? nullptr : (const uint8_t *)p);
+    }
+    close(fd);  // The mapping stays valid
+    if (len && !ptr) {
+        throw std::runtime_error("MappedFile.MappedFile(): Fail to map file: " + filename);
+    }
+}
+
+MappedFile::~MappedFile() {
+    release();
+}
+
+void MappedFile::release() {
+    if (ptr) {
+        munmap((void *)ptr, len);
+        ptr = nullptr;
+    }
+}
+
+#endif
+
+const uint8_t* MappedFile::data() const {
+    return ptr;
+}
+
+MappedFile::SizeType MappedFile::size() const {
+    return len;
+}
+
+}
@@ -0,0 +1,179 @@
+#include "util/renderer.h"
+#include <cstdio>
+
+#ifdef OS_UNIX
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+/*
+Offsets of the console colors from the ANSI codes of black, which are 30
+for the foreground and 40 for the background.
+*/
+static const uint8_t ANSI_OFFSET[] = {
+    0,  // BLACK
+    1,  // RED
+    2,  // GREEN
+    4,  // BLUE
+    3,  // YELLOW
+    6,  // CYAN
+    5,  // MAGENTA
+    7,  // WHITE
+};
+
+bool Renderer::Cell::sameColor(const Cell &c) const {
+    return fore == c.fore && back == c.back
+        && foreIntensified == c.foreIntensified && backIntensified == c.backIntensified;
+}
+
+bool Renderer::Cell::operator==(const Cell &c) const {
+    return text[0] == c.text[0] && text[1] == c.text[1] && sameColor(c);
+}
+
+bool Renderer::Cell::operator!=(const Cell &c) const {
+    return !(*this == c);
+}
+
+Renderer::Renderer() {}
+
+Renderer::~Renderer() {}
+
+void Renderer::resize(const SizeType rows, const SizeType cols) {
+    if (rows == rowCnt && cols == colCnt) {
+        return;
+    }
+    rowCnt = rows;
+    colCnt = cols;
+    Cell blank = {{' ', ' '}, BLACK, BLACK, 0, 0};
+    cells.assign(rows * cols, blank);
+    shown.assign(rows * cols, blank);
+    full = true;
+}
+
+void Renderer::setCell(const SizeType row, const SizeType col, const std::string &text,
+                       const ConsoleColor &color) {
+    Cell &cell = cells[row * colCnt + col];
+    cell.text[0] = text.size() > 0 ? text[0] : ' ';
+    cell.text[1] = text.size() > 1 ? text[1] : ' ';
+    cell.fore = (uint8_t)color.foreColor;
+    cell.back = (uint8_t)color.backColor;
+    cell.foreIntensified = color.foreIntensified;
+    cell.backIntensified = color.backIntensified;
+}
+
+void Renderer::invalidate() {
+    full = true;
+}
+
+#ifdef OS_UNIX
+
+void Renderer::present() {
+    out.clear();
+    const Cell *color = nullptr;  // Color of the last escape
+    for (SizeType i = 0; i < rowCnt; ++i) {
+        SizeType cursor = colCnt;  // Column the cursor is at in this row, if known
+        for (SizeType j = 0; j < colCnt; ++j) {
+            SizeType idx = i * colCnt + j;
+            const Cell &cell = cells[idx];
+            if (!full && cell == shown[idx]) {
+                continue;
+            }
+            if (cursor != j) {
+                appendCursor(i, j);
+            }
+            if (!color || !color->sameColor(cell)) {
+                appendColor(cell);
+                color = &cell;
+            }
+            out.append(cell.text, 2);
+            shown[idx] = cell;
+            cursor = j + 1;
+        }
+    }
+    full = false;
+    if (!out.empty()) {
+        out.append("\033[0m");
+        flush();
+    }
+}
+
+void Renderer::appendCursor(const SizeType row, const SizeType col) {
+    out.append("\033[");
+    appendInt(row + 1);
+    out.push_back(';');
+    appendInt(col * 2 + 1);
+    out.push_back('H');
+}
+
+void Renderer::appendColor(const Cell &cell) {
+    out.append("\033[");
+    appendInt(30 + ANSI_OFFSET[cell.fore]);
+    out.push_back(';');
+    appendInt(40 + ANSI_OFFSET[cell.back]);
+    out.push_back('m');
+}
+
+void Renderer::appendInt(SizeType value) {
+    char buf[24];
+    int len = 0;
+    do {
+        buf[len++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    while (len) {
+        out.push_back(buf[--len]);
+    }
+}
+
+void Renderer::flush() {
+    fflush(stdout);  // Keep the order with the output of Console
+    const char *p = out.data();
+    SizeType left = out.size();
+    while (left) {
+        ssize_t n = ::write(STDOUT_FILENO, p, left);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        p += n;
+        left -= (SizeType)n;
+    }
+}
+
+#else
+
+/*
+Console colors are not escape sequences here, so each run of changed
+cells with the same color is written by Console on its own.
+*/
+void Renderer::present() {
+    for (SizeType i = 0; i < rowCnt; ++i) {
+        SizeType j = 0;
+        while (j < colCnt) {
+            SizeType idx = i * colCnt + j;
+            if (!full && cells[idx] == shown[idx]) {
+                ++j;
+                continue;
+            }
+            const Cell &first = cells[idx];
+            out.clear();
+            SizeType beg = j;
+            while (j < colCnt && cells[i * colCnt + j].sameColor(first)
+                   && (full || cells[i * colCnt + j] != shown[i * colCnt + j])) {
+                out.append(cells[i * colCnt + j].text, 2);
+                shown[i * colCnt + j] = cells[i * colCnt + j];
+                ++j;
+            }
+            Console::setCursor((int)(beg * 2), (int)i);
+            Console::writeWithColor(out, ConsoleColor((ConsoleColorType)first.fore,
+                                                      (ConsoleColorType)first.back,
+                                                      first.foreIntensified != 0,
+                                                      first.backIntensified != 0));
+        }
+    }
+    full = false;
+}
+
+#endif
@@ -0,0 +1,97 @@
+#include "util/threadpool.h"
+
+namespace util {
+
+ThreadPool::ThreadPool(const SizeType threadCnt) : queued(0), pending(0) {
+    SizeType cnt = threadCnt ? threadCnt : 1;
+    for (SizeType i = 0; i < cnt; ++i) {
+        workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    }
+    for (SizeType i = 0; i < cnt; ++i) {
+        threads.push_back(std::thread(&ThreadPool::work, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    taskCond.notify_all();
+    for (std::thread &t : threads) {
+        t.join();
+    }
+}
+
+ThreadPool::SizeType ThreadPool::getThreadCount() const {
+    return threads.size();
+}
+
+void ThreadPool::submit(const Task &task) {
+    ++pending;
+    SizeType id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        id = nextWorker;
+        nextWorker = (nextWorker + 1) % workers.size();
+    }
+    Worker &worker = *workers[id];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(task);
+    }
+    {
+        // Counted under the pool mutex so a worker about to sleep cannot miss it
+        std::lock_guard<std::mutex> lock(mutex);
+        ++queued;
+    }
+    taskCond.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCond.wait(lock, [this] { return pending == 0; });
+}
+
+void ThreadPool::work(const SizeType id) {
+    Task task;
+    while (true) {
+        if (takeTask(id, task)) {
+            task();
+            task = nullptr;
+            if (--pending == 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                doneCond.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        taskCond.wait(lock, [this] { return stop || queued > 0; });
+        if (stop && queued == 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::takeTask(const SizeType id, Task &task) {
+    SizeType cnt = workers.size();
+    for (SizeType i = 0; i < cnt; ++i) {
+        Worker &worker = *workers[(id + i) % cnt];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            if (i == 0) {
+                task = worker.tasks.back();
+                worker.tasks.pop_back();
+            } else {
+                task = worker.tasks.front();
+                worker.tasks.pop_front();
+            }
+            --queued;
+            return true;
+        }
+    }
+    return false;
+}
+
+}